@@ -0,0 +1,826 @@
+#include "benchmarks/harness.hpp"
+#include "src/container.hpp"
+#include "src/fs.hpp"
+#include "src/id.hpp"
+#include "src/log.hpp"
+#include "src/math.hpp"
+#include "src/memory.hpp"
+#include "src/os.hpp"
+#include "src/string.hpp"
+#include "src/thread.hpp"
+#include "src/time.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace mcl::utils;
+
+namespace
+{
+/* legacyToFloat_
+Previous, exception-based implementation of string::toFloat, kept here as a
+baseline. */
+
+float legacyToFloat_(const std::string& s)
+{
+	try
+	{
+		return std::stof(s);
+	}
+	catch (const std::exception&)
+	{
+		return 0.0f;
+	}
+}
+
+/* legacyReplace_
+Previous, in-place implementation of string::replace, kept here as a baseline:
+each hit shifts the rest of the string. */
+
+std::string legacyReplace_(std::string in, const std::string& search, const std::string& replace)
+{
+	std::size_t pos = 0;
+	while ((pos = in.find(search, pos)) != std::string::npos)
+	{
+		in.replace(pos, search.length(), replace);
+		pos += replace.length();
+	}
+	return in;
+}
+
+/* makeNumbers_
+Returns 'count' comma-separated numbers, one field out of 'garbageEvery' being
+malformed. */
+
+std::string makeNumbers_(std::size_t count, std::size_t garbageEvery)
+{
+	std::string out;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		if (garbageEvery != 0 && i % garbageEvery == 0)
+			out += "n/a";
+		else
+			out += std::to_string(static_cast<float>(i) * 0.37f);
+		out += ',';
+	}
+	return out;
+}
+
+/* makeText_
+Returns about 'size' bytes of space-separated words. */
+
+std::string makeText_(std::size_t size)
+{
+	const std::vector<std::string> words = {"kick", "snare", "hi-hat", "%20", "loop", "file://", "sample", "x"};
+
+	std::string  out;
+	std::mt19937 rng{1};
+	while (out.size() < size)
+	{
+		out += words[rng() % words.size()];
+		out += ' ';
+	}
+	return out;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* benchmarkRemoval_
+Compares the ordered removal functions with their batch and unordered
+variants on 'size' ints. Every operation works on a fresh copy: the "std::vector copy"
+entry is the baseline to subtract. */
+
+void benchmarkRemoval_(std::size_t size)
+{
+	using namespace mcl::utils::container;
+
+	constexpr std::size_t REMOVALS = 100;
+
+	const std::string suffix = " - " + std::to_string(size);
+
+	std::vector<int> vec(size);
+	std::iota(vec.begin(), vec.end(), 0);
+
+	std::mt19937             random(42);
+	std::vector<std::size_t> indexes(REMOVALS);
+	for (std::size_t& index : indexes)
+		index = std::uniform_int_distribution<std::size_t>(0, size - REMOVALS)(random);
+	std::sort(indexes.begin(), indexes.end());
+
+	bench::run("std::vector copy" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		return copy.size();
+	});
+	bench::run("removeAt, 100 indexes" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		for (auto it = indexes.rbegin(); it != indexes.rend(); ++it) // Back to front, so that indexes stay valid
+			removeAt(copy, *it);
+		return copy.size();
+	});
+	bench::run("removeAtMany, 100 indexes" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		removeAtMany(copy, indexes);
+		return copy.size();
+	});
+	bench::run("removeAtUnordered, 100 indexes" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		for (auto it = indexes.rbegin(); it != indexes.rend(); ++it)
+			removeAtUnordered(copy, *it);
+		return copy.size();
+	});
+	bench::run("removeIf, 1%" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		removeIf(copy, [](int i) { return i % 100 == 0; });
+		return copy.size();
+	});
+	bench::run("removeIfUnordered, 1%" + suffix, {.items = size}, [&]() {
+		std::vector<int> copy = vec;
+		removeIfUnordered(copy, [](int i) { return i % 100 == 0; });
+		return copy.size();
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* benchmarkIdMap_
+Compares IdMap with std::unordered_map on 'size' sequential Ids: insertion into
+a reserved map, successful lookups, lookups of missing keys and erasure. Lookups
+and erasures go in random order. */
+
+void benchmarkIdMap_(std::size_t size)
+{
+	const std::string suffix = " - " + std::to_string(size);
+
+	std::vector<Id> shuffled;
+	for (std::size_t i = 1; i <= size; i++)
+		shuffled.push_back(Id{i});
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{1});
+
+	container::IdMap<int>       idMap(size);
+	std::unordered_map<Id, int> stdMap;
+	stdMap.reserve(size);
+	for (std::size_t i = 1; i <= size; i++)
+	{
+		idMap.emplace(Id{i}, static_cast<int>(i));
+		stdMap.emplace(Id{i}, static_cast<int>(i));
+	}
+
+	bench::run("insert std::unordered_map" + suffix, {.items = size}, [size]() {
+		std::unordered_map<Id, int> map;
+		map.reserve(size);
+		for (std::size_t i = 1; i <= size; i++)
+			map.emplace(Id{i}, static_cast<int>(i));
+		return map.size();
+	});
+
+	bench::run("insert IdMap" + suffix, {.items = size}, [size]() {
+		container::IdMap<int> map(size);
+		for (std::size_t i = 1; i <= size; i++)
+			map.emplace(Id{i}, static_cast<int>(i));
+		return map.size();
+	});
+
+	bench::run("find std::unordered_map" + suffix, {.items = size}, [&]() {
+		long long sum = 0;
+		for (const Id& id : shuffled)
+			sum += stdMap.find(id)->second;
+		return sum;
+	});
+
+	bench::run("find IdMap" + suffix, {.items = size}, [&]() {
+		long long sum = 0;
+		for (const Id& id : shuffled)
+			sum += *idMap.find(id);
+		return sum;
+	});
+
+	bench::run("find missing std::unordered_map" + suffix, {.items = size}, [&]() {
+		std::size_t found = 0;
+		for (std::size_t i = size + 1; i <= size * 2; i++)
+			found += stdMap.count(Id{i});
+		return found;
+	});
+
+	bench::run("find missing IdMap" + suffix, {.items = size}, [&]() {
+		std::size_t found = 0;
+		for (std::size_t i = size + 1; i <= size * 2; i++)
+			found += idMap.contains(Id{i});
+		return found;
+	});
+
+	/* Erase benchmarks include the copy of the full map, which is measured
+	separately for reference. */
+
+	bench::run("copy std::unordered_map" + suffix, {.items = size}, [&]() {
+		std::unordered_map<Id, int> map = stdMap;
+		return map.size();
+	});
+
+	bench::run("copy + erase std::unordered_map" + suffix, {.items = size}, [&]() {
+		std::unordered_map<Id, int> map = stdMap;
+		for (const Id& id : shuffled)
+			map.erase(id);
+		return map.size();
+	});
+
+	bench::run("copy IdMap" + suffix, {.items = size}, [&]() {
+		container::IdMap<int> map = idMap;
+		return map.size();
+	});
+
+	bench::run("copy + erase IdMap" + suffix, {.items = size}, [&]() {
+		container::IdMap<int> map = idMap;
+		for (const Id& id : shuffled)
+			map.erase(id);
+		return map.size();
+	});
+}
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("string")
+{
+	using namespace mcl::utils::string;
+
+	const std::string text    = makeText_(64 * 1024);
+	const std::string numbers = makeNumbers_(100000, 10);
+	const std::string padded  = "   " + text.substr(0, 1024) + "   ";
+
+	bench::run("replace", {.bytes = text.size()}, [&]() { return replace(text, "%20", " "); });
+	bench::run("replace - legacy", {.bytes = text.size()}, [&]() { return legacyReplace_(text, "%20", " "); });
+
+	const std::string large = makeText_(1024 * 1024);
+	bench::run("replace - 1MB", {.bytes = large.size()}, [&]() { return replace(large, "%20", " "); });
+	bench::run("replace - 1MB, legacy", {.bytes = large.size()}, [&]() { return legacyReplace_(large, "%20", " "); });
+
+	const Replacer replacer({{"%20", " "}, {"file://", ""}, {"kick", "bd"}, {"snare", "sd"}, {"hi-hat", "hh"}});
+	bench::run("Replacer - 1MB, 5 pairs", {.bytes = large.size()}, [&]() { return replacer.apply(large); });
+	bench::run("replace - 1MB, 5 chained calls", {.bytes = large.size()}, [&]() {
+		return replace(replace(replace(replace(replace(large, "%20", " "), "file://", ""), "kick", "bd"), "snare", "sd"), "hi-hat", "hh");
+	});
+
+	/* Percent-decoding: many pairs, one scan for Replacer against one per pair. */
+
+	Replacer::Pairs escapes;
+	for (char c = ' '; c < '0'; c++)
+		escapes.emplace_back("%" + std::to_string(c / 16) + "0123456789ABCDEF"[c % 16], std::string(1, c));
+	const Replacer decoder(escapes);
+	bench::run("Replacer - 1MB, 16 pairs", {.bytes = large.size()}, [&]() { return decoder.apply(large); });
+	bench::run("replace - 1MB, 16 chained calls", {.bytes = large.size()}, [&]() {
+		std::string out = large;
+		for (const auto& [search, replacement] : escapes)
+			out = replace(std::move(out), search, replacement);
+		return out;
+	});
+	bench::run("trim", {.bytes = padded.size()}, [&]() { return trim(padded); });
+	bench::run("split", {.bytes = text.size()}, [&]() { return split(text, " "); });
+
+	bench::run("splitView", {.bytes = text.size()}, [&]() {
+		std::size_t count = 0;
+		for (std::string_view token : splitView(text, " "))
+			count += token.size();
+		return count;
+	});
+
+	bench::run("contains", {.bytes = text.size()}, [&]() { return contains(text, '#'); });
+
+	bench::run("toFloat - legacy, valid", [&]() { return legacyToFloat_("1234.5678"); });
+	bench::run("toFloat - valid", [&]() { return toFloat("1234.5678"); });
+	bench::run("toFloat - legacy, malformed", [&]() { return legacyToFloat_("n/a"); });
+	bench::run("toFloat - malformed", [&]() { return toFloat("n/a"); });
+	bench::run("toInt", [&]() { return toInt("123456"); });
+	bench::run("parseFloat", [&]() { return parseFloat("1234.5678"); });
+	bench::run("parseInt", [&]() { return parseInt("123456"); });
+
+	bench::run("100k floats - legacy split + toFloat", {.bytes = numbers.size(), .items = 100000}, [&]() {
+		std::vector<float> out;
+		for (const std::string& token : split(numbers, ","))
+			out.push_back(legacyToFloat_(token));
+		return out.size();
+	});
+
+	std::vector<float> floats(100000);
+	bench::run("100k floats - parseFloats", {.bytes = numbers.size(), .items = 100000}, [&]() {
+		return parseFloats(numbers, ",", floats).count;
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("math")
+{
+	using namespace mcl::utils::math;
+
+	constexpr std::size_t BLOCK_SIZE = 1024;
+
+	std::vector<float> in(BLOCK_SIZE);
+	std::vector<float> out(BLOCK_SIZE);
+	for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+		in[i] = static_cast<float>(i + 1) / BLOCK_SIZE;
+
+	bench::run("linearToDB - scalar", {.items = BLOCK_SIZE}, [&]() {
+		for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+			out[i] = linearToDB(in[i]);
+		return out[0];
+	});
+	bench::run("linearToDB - block", {.items = BLOCK_SIZE}, [&]() {
+		linearToDB(in, out);
+		return out[0];
+	});
+	bench::run("dBtoLinear - scalar", {.items = BLOCK_SIZE}, [&]() {
+		for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+			out[i] = dBtoLinear(in[i]);
+		return out[0];
+	});
+	bench::run("dBtoLinear - block", {.items = BLOCK_SIZE}, [&]() {
+		dBtoLinear(in, out);
+		return out[0];
+	});
+
+	bench::run("quantize", {.items = BLOCK_SIZE}, [&]() {
+		int sum = 0;
+		for (int i = 0; i < static_cast<int>(BLOCK_SIZE); i++)
+			sum += quantize(i, 7);
+		return sum;
+	});
+
+	bench::run("map", {.items = BLOCK_SIZE}, [&]() {
+		for (std::size_t i = 0; i < BLOCK_SIZE; i++)
+			out[i] = map(in[i], 0.0f, 1.0f, -1.0f, 1.0f);
+		return out[0];
+	});
+
+	const Mapper<float, float> mapper(0.0f, 1.0f, -1.0f, 1.0f);
+	bench::run("Mapper::apply", {.items = BLOCK_SIZE}, [&]() {
+		mapper.apply(in, out);
+		return out[0];
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("fs")
+{
+	using namespace mcl::utils::fs;
+
+	const std::string path = "/home/user/samples/drums/kick/808 kick - long.wav";
+	const std::string uri  = "file:///home/user/samples/drums/kick/808%20kick%20-%20long.wav";
+
+	bench::run("basename", [&]() { return basename(path); });
+	bench::run("dirname", [&]() { return dirname(path); });
+	bench::run("getExt", [&]() { return getExt(path); });
+	bench::run("stripExt", [&]() { return stripExt(path); });
+	bench::run("getUpDir", [&]() { return getUpDir(path); });
+	bench::run("join", [&]() { return join("/home/user/samples", "kick.wav"); });
+
+	char buffer[256];
+	bench::run("basenameView", [&]() { return basenameView(path); });
+	bench::run("dirnameView", [&]() { return dirnameView(path); });
+	bench::run("getExtView", [&]() { return getExtView(path); });
+	bench::run("getStemView", [&]() { return getStemView(path); });
+	bench::run("stripExtView", [&]() { return stripExtView(path); });
+	bench::run("join - buffer", [&]() { return join("/home/user/samples", "kick.wav", buffer); });
+	bench::run("uriToPath", [&]() { return uriToPath(uri); });
+	bench::run("isValidFileName", [&]() { return isValidFileName("808 kick - long.wav"); });
+	bench::run("isRootDir", [&]() { return isRootDir(path); });
+	bench::run("fileExists", [&]() { return fileExists(path); });
+	bench::run("isDir", [&]() { return isDir("."); });
+	bench::run("dirExists", [&]() { return dirExists("."); });
+	bench::run("getRealPath", [&]() { return getRealPath("."); });
+	bench::run("getCurrentPath", [&]() { return getCurrentPath(); });
+	bench::run("getConfigDirPath", [&]() { return getConfigDirPath(); });
+
+	MetadataCache cache;
+	cache.watch(".");
+	bench::run("MetadataCache::fileExists", [&]() { return cache.fileExists(path); });
+	bench::run("MetadataCache::isDir", [&]() { return cache.isDir("."); });
+	bench::run("MetadataCache::getRealPath", [&]() { return cache.getRealPath("."); });
+
+	const std::size_t files = scan(".", {}, [](std::span<const std::string>) {});
+	bench::run("scan - current dir", {.items = files}, [&]() { return scan(".", {}, [](std::span<const std::string>) {}); });
+	bench::run("scan - current dir, 1 thread", {.items = files}, [&]() { return scan(".", {.extensions = {}, .threads = 1}, [](std::span<const std::string>) {}); });
+
+	/* Loading a batch of samples: serial reads vs AsyncReader. Files are likely
+	in the page cache, so this mostly measures per-file overhead. */
+
+	constexpr std::size_t FILES     = 64;
+	constexpr std::size_t FILE_SIZE = 256 * 1024;
+
+	const std::filesystem::path root = std::filesystem::temp_directory_path() / "mcl-utils-benchmark-async-reader";
+	std::filesystem::create_directories(root);
+	std::vector<std::string> paths;
+	for (std::size_t i = 0; i < FILES; i++)
+	{
+		paths.push_back((root / std::to_string(i)).string());
+		std::ofstream(paths.back(), std::ios::binary) << std::string(FILE_SIZE, 'x');
+	}
+
+	bench::run("load 64 files - ifstream", {.bytes = FILES * FILE_SIZE, .items = FILES}, [&]() {
+		std::size_t total = 0;
+		for (const std::string& path : paths)
+		{
+			std::ifstream     stream(path, std::ios::binary);
+			std::vector<char> data(FILE_SIZE);
+			stream.read(data.data(), data.size());
+			total += stream.gcount();
+		}
+		return total;
+	});
+	for (const bool preferIoUring : {false, true})
+	{
+		AsyncReader       reader({.preferIoUring = preferIoUring});
+		const std::string name = reader.getBackend() == AsyncReader::Backend::IO_URING ? "io_uring" : "threads";
+		bench::run("load 64 files - AsyncReader, " + name, {.bytes = FILES * FILE_SIZE, .items = FILES}, [&]() {
+			std::atomic<std::size_t> total = 0;
+			reader.read(paths, [&total](AsyncReader::Result& r) { total += r.data.size(); });
+			reader.wait();
+			return total.load();
+		});
+	}
+
+	/* Saving a document in 4 KiB chunks. */
+
+	const std::string savePath = (root / "save").string();
+	const std::string chunk(4096, 'x');
+	bench::run("save 16 MiB - ofstream", {.bytes = FILES * FILE_SIZE}, [&]() {
+		std::ofstream stream(savePath, std::ios::binary);
+		for (std::size_t i = 0; i < FILES * FILE_SIZE / chunk.size(); i++)
+			stream << chunk;
+		return stream.good();
+	});
+	for (const bool durable : {false, true})
+	{
+		bench::run(durable ? "save 16 MiB - AtomicWriter, durable" : "save 16 MiB - AtomicWriter", {.bytes = FILES * FILE_SIZE}, [&]() {
+			AtomicWriter writer(savePath, {.durable = durable});
+			for (std::size_t i = 0; i < FILES * FILE_SIZE / chunk.size(); i++)
+				writer.write(chunk);
+			return writer.commit();
+		});
+	}
+	std::filesystem::remove_all(root);
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("container")
+{
+	using namespace mcl::utils::container;
+
+	constexpr std::size_t SIZE = 10000;
+
+	std::vector<int> vec(SIZE);
+	std::iota(vec.begin(), vec.end(), 0);
+
+	bench::run("indexOf", {.items = SIZE}, [&]() { return indexOf(vec, static_cast<int>(SIZE - 1)); });
+	bench::run("has", {.items = SIZE}, [&]() { return has(vec, -1); });
+	bench::run("hasIf", {.items = SIZE}, [&]() { return hasIf(vec, [](int i) { return i < 0; }); });
+	bench::run("hasIfBlockwise", {.items = SIZE}, [&]() { return hasIfBlockwise(vec, [](int i) { return i < 0; }); });
+	bench::run("findIf", {.items = SIZE}, [&]() { return *findIf(vec, [](int i) { return i == SIZE - 1; }); });
+	bench::run("std::find", {.items = SIZE}, [&]() { return std::find(vec.begin(), vec.end(), static_cast<int>(SIZE - 1)) - vec.begin(); });
+	bench::run("std::any_of", {.items = SIZE}, [&]() { return std::any_of(vec.begin(), vec.end(), [](int i) { return i < 0; }); });
+
+	std::vector<float> floats(vec.begin(), vec.end());
+	std::vector<Id>    ids;
+	for (const int i : vec)
+		ids.emplace_back(static_cast<std::size_t>(i));
+	bench::run("indexOf - float", {.items = SIZE}, [&]() { return indexOf(floats, -1.0f); });
+	bench::run("indexOf - Id", {.items = SIZE}, [&]() { return indexOf(ids, Id{SIZE}); });
+
+	/* Random lookups in a sorted vector. */
+
+	std::mt19937     random(42);
+	std::vector<int> lookups(1024);
+	for (int& lookup : lookups)
+		lookup = std::uniform_int_distribution<int>(0, SIZE - 1)(random);
+	bench::run("sortedIndexOf", {.items = lookups.size()}, [&]() {
+		std::size_t sum = 0;
+		for (const int lookup : lookups)
+			sum += sortedIndexOf(vec, lookup);
+		return sum;
+	});
+	bench::run("std::lower_bound", {.items = lookups.size()}, [&]() {
+		std::size_t sum = 0;
+		for (const int lookup : lookups)
+			sum += static_cast<std::size_t>(std::lower_bound(vec.begin(), vec.end(), lookup) - vec.begin());
+		return sum;
+	});
+	bench::run("atOr", [&]() { return atOr(vec, SIZE, -1); });
+	bench::run("cast", {.items = SIZE}, [&]() { return cast<int>(range(static_cast<int>(SIZE))); });
+
+	bench::run("removeIf", {.items = SIZE}, [&]() {
+		std::vector<int> copy = vec;
+		removeIf(copy, [](int i) { return i % 2 == 0; });
+		return copy.size();
+	});
+	bench::run("remove", {.items = SIZE}, [&]() {
+		std::vector<int> copy = vec;
+		remove(copy, 42);
+		return copy.size();
+	});
+	bench::run("removeAt", {.items = SIZE}, [&]() {
+		std::vector<int> copy = vec;
+		removeAt(copy, 0);
+		return copy.size();
+	});
+
+	bench::run("SlotMap - insert + erase", {.items = SIZE}, [&]() {
+		SlotMap<int>    map;
+		std::vector<Id> keys;
+		map.reserve(SIZE);
+		keys.reserve(SIZE);
+		for (std::size_t i = 0; i < SIZE; i++)
+			keys.push_back(map.insert(static_cast<int>(i)));
+		for (const Id& key : keys)
+			map.erase(key);
+		return map.size();
+	});
+
+	SlotMap<int>    slotMap;
+	std::vector<Id> keys;
+	for (std::size_t i = 0; i < SIZE; i++)
+		keys.push_back(slotMap.insert(static_cast<int>(i)));
+
+	bench::run("SlotMap - get", {.items = SIZE}, [&]() {
+		long long sum = 0;
+		for (const Id& key : keys)
+			sum += *slotMap.get(key);
+		return sum;
+	});
+
+	bench::run("SlotMap - iterate", {.items = SIZE}, [&]() { return std::accumulate(slotMap.begin(), slotMap.end(), 0LL); });
+
+	benchmarkIdMap_(1000);
+	benchmarkIdMap_(100000);
+
+	benchmarkRemoval_(10000);
+	benchmarkRemoval_(1000000);
+
+	RingBuffer<int> ring(1024);
+	bench::run("RingBuffer - push + pop", [&]() {
+		int out = 0;
+		ring.push(42);
+		ring.pop(out);
+		return out;
+	});
+
+	MpmcQueue<int> mpmc(1024);
+	bench::run("MpmcQueue - push + pop", [&]() {
+		int out = 0;
+		mpmc.push(42);
+		mpmc.pop(out);
+		return out;
+	});
+
+	/* Passing events from one thread to another, against the usual vector
+	guarded by a mutex and swapped out by the consumer. */
+
+	constexpr std::size_t EVENTS = 1000000;
+
+	bench::run("RingBuffer - 1M events across threads", {.items = EVENTS}, [&]() {
+		RingBuffer<std::size_t> queue(4096);
+		const auto              produce = [&queue]() {
+			for (std::size_t i = 0; i < EVENTS; i++)
+				while (!queue.push(i))
+					std::this_thread::yield();
+		};
+
+		std::thread producer(produce);
+		std::size_t sum = 0;
+		std::size_t buffer[256];
+		for (std::size_t received = 0; received < EVENTS;)
+		{
+			const std::size_t count = queue.pop(buffer);
+			if (count == 0)
+				std::this_thread::yield();
+			for (std::size_t i = 0; i < count; i++)
+				sum += buffer[i];
+			received += count;
+		}
+		producer.join();
+		return sum;
+	});
+	bench::run("mutex + std::vector - 1M events across threads", {.items = EVENTS}, [&]() {
+		std::mutex               mutex;
+		std::vector<std::size_t> shared, local;
+		const auto               produce = [&]() {
+			for (std::size_t i = 0; i < EVENTS; i++)
+			{
+				std::scoped_lock lock(mutex);
+				shared.push_back(i);
+			}
+		};
+
+		std::thread producer(produce);
+		std::size_t sum = 0;
+		for (std::size_t received = 0; received < EVENTS;)
+		{
+			{
+				std::scoped_lock lock(mutex);
+				local.swap(shared);
+			}
+			if (local.empty())
+				std::this_thread::yield();
+			for (const std::size_t i : local)
+				sum += i;
+			received += local.size();
+			local.clear();
+		}
+		producer.join();
+		return sum;
+	});
+}
+
+/* Hidden by default: 10M entries need a few GB of memory and a long time. Run
+explicitly with './benchmarks container-large'. */
+
+MCL_BENCHMARK_HIDDEN("container-large")
+{
+	benchmarkIdMap_(10000000);
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("id")
+{
+	IdGenerator generator;
+
+	bench::run("IdGenerator::generate", [&]() { return generator.generate(); });
+	bench::run("std::hash<Id>", [&]() { return std::hash<Id>{}(Id{12345}); });
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("log")
+{
+	log::setSink([](log::Level, std::string_view) {});
+	log::registerThread();
+
+	bench::run("ML_INFO", [&]() { ML_INFO("value: " << 42 << ", " << 0.5f); });
+
+	log::flush();
+	log::setSink({});
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("os")
+{
+	bench::run("getCpuCount", [&]() { return os::getCpuCount().physical; });
+	bench::run("prefaultStack - 256 KiB", {.bytes = 256 * 1024}, [&]() { os::prefaultStack(256 * 1024); });
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("time")
+{
+	using namespace std::chrono_literals;
+
+	bench::run("sleep(1)", [&]() { time::sleep(1); });
+
+	time::calibrate();
+	time::Stopwatch        stopwatch;
+	time::LatencyHistogram histogram;
+	bench::run("steady_clock::now", [&]() { return std::chrono::steady_clock::now(); });
+	bench::run("getTicks", [&]() { return time::getTicks(); });
+	bench::run("Stopwatch::getElapsed", [&]() { return stopwatch.getElapsed(); });
+	bench::run("LatencyHistogram::record", [&]() { histogram.record(std::chrono::nanoseconds(time::getTicks() & 0xFFFFF)); });
+	bench::run("ScopedTimer", [&]() { time::ScopedTimer timer(histogram); });
+	bench::run("LatencyHistogram::getSummary", [&]() { return histogram.getSummary().p99; });
+
+	/* Wake-up jitter: how late each wait returns, over 1 ms waits. */
+
+	constexpr std::size_t SAMPLES = 500;
+
+	const auto measureLateness = [](const std::function<time::Clock::time_point()>& wait) {
+		std::vector<double> lateness;
+		lateness.reserve(SAMPLES);
+		for (std::size_t i = 0; i < SAMPLES; i++)
+		{
+			const time::Clock::time_point deadline = wait();
+			lateness.push_back(std::chrono::duration<double, std::micro>(time::Clock::now() - deadline).count());
+		}
+		std::sort(lateness.begin(), lateness.end());
+		return std::vector<bench::Metric>{
+		    {"late_us_p50", lateness[SAMPLES / 2]},
+		    {"late_us_p99", lateness[SAMPLES * 99 / 100]},
+		    {"late_us_max", lateness.back()}};
+	};
+
+	bench::report("jitter - std::this_thread::sleep_for", [&]() {
+		return measureLateness([]() {
+			const time::Clock::time_point deadline = time::Clock::now() + 1ms;
+			std::this_thread::sleep_for(1ms);
+			return deadline;
+		});
+	});
+	for (const auto spin : {0us, 50us, 200us})
+	{
+		bench::report("jitter - sleepUntil, spin " + std::to_string(spin.count()) + "us", [&]() {
+			return measureLateness([spin]() {
+				const time::Clock::time_point deadline = time::Clock::now() + 1ms;
+				time::sleepUntil(deadline, spin);
+				return deadline;
+			});
+		});
+	}
+	bench::report("jitter - PeriodicTimer, spin 50us", [&]() {
+		time::PeriodicTimer timer(1ms, 50us);
+		return measureLateness([&timer]() {
+			const time::Clock::time_point deadline = timer.getNextDeadline();
+			timer.wait();
+			return deadline;
+		});
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("thread")
+{
+	constexpr std::size_t TASKS = 10000;
+
+	thread::ThreadPool pool;
+
+	bench::run("ThreadPool - 10k tasks", {.items = TASKS}, [&]() {
+		std::vector<thread::Future<std::size_t>> futures;
+		futures.reserve(TASKS);
+		for (std::size_t i = 0; i < TASKS; i++)
+			futures.push_back(pool.submit([i]() { return i; }));
+		std::size_t sum = 0;
+		for (auto& future : futures)
+			sum += future.get();
+		return sum;
+	});
+	bench::run("ThreadPool - 10k nested tasks", {.items = TASKS}, [&]() {
+		std::atomic<std::size_t> sum = 0;
+		const auto               spawn = [&]() {
+			for (std::size_t i = 0; i < TASKS; i++)
+				pool.submit([&sum, i]() { sum += i; });
+		};
+		pool.submit(spawn).wait();
+		while (sum.load() != TASKS * (TASKS - 1) / 2)
+			std::this_thread::yield();
+		return sum.load();
+	});
+	bench::run("std::async - 10k tasks", {.items = TASKS}, [&]() {
+		std::vector<std::future<std::size_t>> futures;
+		futures.reserve(TASKS);
+		for (std::size_t i = 0; i < TASKS; i++)
+			futures.push_back(std::async(std::launch::async, [i]() { return i; }));
+		std::size_t sum = 0;
+		for (auto& future : futures)
+			sum += future.get();
+		return sum;
+	});
+}
+
+/* -------------------------------------------------------------------------- */
+
+MCL_BENCHMARK("memory")
+{
+	const std::set<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+	const std::string   line    = "kick,snare,hi-hat,a-token-longer-than-sso-buffer,loop";
+
+	memory::ArenaResource arena(1 << 16);
+	memory::PoolResource  pool(64, 1024);
+
+	bench::run("container::cast - std::vector", [&]() { return container::cast<int>(numbers).size(); });
+	bench::run("container::cast - ArenaResource", [&]() {
+		arena.reset();
+		return container::cast<int>(numbers, &arena).size();
+	});
+	bench::run("string::split - std::vector", [&]() { return string::split(line, ",").size(); });
+	bench::run("string::split - ArenaResource", [&]() {
+		arena.reset();
+		return string::split(line, ",", &arena).size();
+	});
+	bench::run("container::cast - SmallVector<int, 16>", [&]() { return container::cast<int, container::SmallVector<int, 16>>(numbers).size(); });
+	bench::run("string::split - SmallVector<std::string_view, 8>", [&]() {
+		return string::split<container::SmallVector<std::string_view, 8>>(line, ",").size();
+	});
+	bench::run("string::split - StaticVector<std::string, 8>", [&]() {
+		return string::split<container::StaticVector<std::string, 8>>(line, ",").size();
+	});
+	bench::run("new + delete - 64 bytes", [&]() {
+		auto* p = new std::byte[64];
+		bench::doNotOptimize(p);
+		delete[] p;
+		return 0;
+	});
+	bench::run("PoolResource - 64 bytes", [&]() {
+		void* p = pool.allocate(64);
+		bench::doNotOptimize(p);
+		pool.deallocate(p, 64);
+		return 0;
+	});
+}
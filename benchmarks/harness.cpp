@@ -0,0 +1,229 @@
+#include "benchmarks/harness.hpp"
+#include "src/os.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+/* Global allocation counter. All the replaceable operator new overloads funnel
+into countedAlloc_, so that allocations/op can be reported. */
+
+namespace
+{
+std::atomic<std::size_t> allocations_{0};
+
+void* countedAlloc_(std::size_t size)
+{
+	allocations_.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* countedAlignedAlloc_(std::size_t size, std::size_t alignment)
+{
+	allocations_.fetch_add(1, std::memory_order_relaxed);
+#if MCL_OS_WINDOWS
+	if (void* p = _aligned_malloc(size != 0 ? size : 1, alignment))
+		return p;
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, std::max(alignment, sizeof(void*)), size != 0 ? size : 1) == 0)
+		return p;
+#endif
+	throw std::bad_alloc();
+}
+
+void alignedFree_(void* p)
+{
+#if MCL_OS_WINDOWS
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc_(size); }
+void* operator new[](std::size_t size) { return countedAlloc_(size); }
+void* operator new(std::size_t size, std::align_val_t a) { return countedAlignedAlloc_(size, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t size, std::align_val_t a) { return countedAlignedAlloc_(size, static_cast<std::size_t>(a)); }
+void  operator delete(void* p) noexcept { std::free(p); }
+void  operator delete[](void* p) noexcept { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete(void* p, std::align_val_t) noexcept { alignedFree_(p); }
+void  operator delete[](void* p, std::align_val_t) noexcept { alignedFree_(p); }
+void  operator delete(void* p, std::size_t, std::align_val_t) noexcept { alignedFree_(p); }
+void  operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alignedFree_(p); }
+
+/* -------------------------------------------------------------------------- */
+
+namespace mcl::utils::bench
+{
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t SAMPLES = 5;
+
+struct Group_
+{
+	std::string_view name;
+	void (*func)();
+	bool hidden;
+};
+
+struct State_
+{
+	std::vector<Group_>       groups;
+	std::string_view          currentGroup;
+	std::string               groupFilter;
+	std::string               nameFilter;
+	std::chrono::microseconds minTime{50000};
+};
+
+State_& getState_()
+{
+	static State_ state;
+	return state;
+}
+
+/* -------------------------------------------------------------------------- */
+
+double measure_(const std::function<void(std::size_t)>& batch, std::size_t n)
+{
+	const auto start = Clock::now();
+	batch(n);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* printString_
+Prints 's' as a JSON string. */
+
+void printString_(std::string_view s)
+{
+	std::putchar('"');
+	for (const char c : s)
+	{
+		if (c == '"' || c == '\\')
+			std::putchar('\\');
+		std::putchar(c);
+	}
+	std::putchar('"');
+}
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+Registrar::Registrar(std::string_view group, void (*func)(), bool hidden)
+{
+	getState_().groups.push_back({group, func, hidden});
+}
+
+/* -------------------------------------------------------------------------- */
+
+void runBatch(std::string_view name, Throughput throughput, const std::function<void(std::size_t n)>& batch)
+{
+	State_& state = getState_();
+
+	if (name.find(state.nameFilter) == std::string_view::npos)
+		return;
+
+	/* Calibration: grow the iteration count until a batch lasts at least
+	minTime / SAMPLES. The first run also acts as warm-up. */
+
+	const double sampleTime = std::chrono::duration<double, std::nano>(state.minTime).count() / SAMPLES;
+	std::size_t  n          = 1;
+	for (double elapsed = measure_(batch, n); elapsed < sampleTime; elapsed = measure_(batch, n))
+		n = elapsed <= 0 ? n * 10 : std::max(n + 1, std::min(n * 10, static_cast<std::size_t>(n * sampleTime / elapsed * 1.2)));
+
+	std::vector<double> samples;
+	samples.reserve(SAMPLES);
+	const std::size_t allocationsBefore = allocations_.load();
+	for (std::size_t i = 0; i < SAMPLES; i++)
+		samples.push_back(measure_(batch, n) / n);
+	const std::size_t allocations = allocations_.load() - allocationsBefore;
+
+	std::sort(samples.begin(), samples.end());
+	const double nsPerOp = samples[SAMPLES / 2];
+
+	std::fputs("{\"group\":", stdout);
+	printString_(state.currentGroup);
+	std::fputs(",\"name\":", stdout);
+	printString_(name);
+	std::printf(",\"iterations\":%zu,\"ns_per_op\":%.3f,\"allocs_per_op\":%.3f,\"bytes_per_s\":%.6g,\"items_per_s\":%.6g}\n",
+	    n, nsPerOp, static_cast<double>(allocations) / (n * SAMPLES),
+	    throughput.bytes * 1e9 / nsPerOp, throughput.items * 1e9 / nsPerOp);
+	std::fflush(stdout);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void report(std::string_view name, const std::function<std::vector<Metric>()>& measure)
+{
+	State_& state = getState_();
+
+	if (name.find(state.nameFilter) == std::string_view::npos)
+		return;
+
+	const std::vector<Metric> metrics = measure();
+
+	std::fputs("{\"group\":", stdout);
+	printString_(state.currentGroup);
+	std::fputs(",\"name\":", stdout);
+	printString_(name);
+	for (const Metric& metric : metrics)
+	{
+		std::putchar(',');
+		printString_(metric.name);
+		std::printf(":%.6g", metric.value);
+	}
+	std::fputs("}\n", stdout);
+	std::fflush(stdout);
+}
+} // namespace mcl::utils::bench
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char** argv)
+{
+	using namespace mcl::utils::bench;
+
+	State_& state = getState_();
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--min-time" && i + 1 < argc)
+			state.minTime = std::chrono::milliseconds(std::atoi(argv[++i]));
+		else if (arg == "--help" || arg == "-h")
+		{
+			std::puts("Usage: benchmarks [group[/name]] [--min-time <ms>]");
+			return 0;
+		}
+		else
+		{
+			const std::size_t slash = arg.find('/');
+			state.groupFilter       = arg.substr(0, slash);
+			state.nameFilter        = slash == std::string_view::npos ? "" : arg.substr(slash + 1);
+		}
+	}
+
+	for (const Group_& group : state.groups)
+	{
+		if (state.groupFilter.empty() ? group.hidden : group.name != state.groupFilter)
+			continue;
+		state.currentGroup = group.name;
+		group.func();
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef MONOCASUAL_UTILS_BENCHMARKS_HARNESS_H
+#define MONOCASUAL_UTILS_BENCHMARKS_HARNESS_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/* Minimal benchmark harness. Benchmarks are grouped by module with
+MCL_BENCHMARK("module") { ... } blocks, in which bench::run() measures a single
+operation. Each result is printed as one JSON object per line (JSON Lines):
+
+    {"group":"string","name":"split","ns_per_op":812.4,"allocs_per_op":4,
+     "bytes_per_s":1.2e+09,"items_per_s":0}
+
+Command line: './benchmarks [group[/name]] [--min-time <ms>]'. Without
+arguments all groups run, except the hidden ones (MCL_BENCHMARK_HIDDEN) which
+must be selected explicitly by name; 'name' is matched as a substring. Build in
+Release mode for meaningful numbers. */
+
+namespace mcl::utils::bench
+{
+/* Throughput
+Amount of work done by a single operation, used to compute throughput. */
+
+struct Throughput
+{
+	std::size_t bytes = 0;
+	std::size_t items = 0;
+};
+
+/* doNotOptimize
+Prevents the compiler from optimizing away the computation of 'v'. */
+
+template <typename T>
+inline void doNotOptimize(const T& v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r"(&v) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &v;
+#endif
+}
+
+/* runBatch
+Measures 'batch', a function that runs the operation under test 'n' times.
+Calibrates 'n' automatically and prints the result. */
+
+void runBatch(std::string_view name, Throughput, const std::function<void(std::size_t n)>& batch);
+
+/* run
+Measures 'op', called repeatedly in a tight loop. Its return value, if any, is
+kept alive so that the compiler can't drop the computation. */
+
+template <typename F>
+void run(std::string_view name, Throughput t, F&& op)
+{
+	runBatch(name, t, [&op](std::size_t n) {
+		for (std::size_t i = 0; i < n; i++)
+		{
+			if constexpr (std::is_void_v<std::invoke_result_t<F&>>)
+				op();
+			else
+				doNotOptimize(op());
+		}
+	});
+}
+
+template <typename F>
+void run(std::string_view name, F&& op)
+{
+	run(name, Throughput{}, std::forward<F>(op));
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Metric
+Named value printed by report(). */
+
+struct Metric
+{
+	std::string_view name;
+	double           value;
+};
+
+/* report
+Prints custom metrics, for benchmarks that don't fit the time-per-operation
+model (e.g. latency distributions). 'measure' is only invoked if 'name' passes
+the command line filter. */
+
+void report(std::string_view name, const std::function<std::vector<Metric>()>& measure);
+
+/* -------------------------------------------------------------------------- */
+
+/* Registrar
+Used by MCL_BENCHMARK to register a group of benchmarks at startup. */
+
+struct Registrar
+{
+	Registrar(std::string_view group, void (*func)(), bool hidden);
+};
+} // namespace mcl::utils::bench
+
+#define MCL_BENCHMARK_CONCAT_(a, b) a##b
+#define MCL_BENCHMARK_NAME_(a, b) MCL_BENCHMARK_CONCAT_(a, b)
+
+#define MCL_BENCHMARK_REGISTER_(group, hidden)                                                   \
+	static void                                 MCL_BENCHMARK_NAME_(mclBenchmark_, __LINE__)(); \
+	static const ::mcl::utils::bench::Registrar MCL_BENCHMARK_NAME_(mclRegistrar_, __LINE__)(    \
+	    group, &MCL_BENCHMARK_NAME_(mclBenchmark_, __LINE__), hidden);                           \
+	static void MCL_BENCHMARK_NAME_(mclBenchmark_, __LINE__)()
+
+#define MCL_BENCHMARK(group) MCL_BENCHMARK_REGISTER_(group, false)
+#define MCL_BENCHMARK_HIDDEN(group) MCL_BENCHMARK_REGISTER_(group, true)
+
+#endif
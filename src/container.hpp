@@ -27,21 +27,215 @@
 #ifndef MONOCASUAL_UTILS_VECTOR_H
 #define MONOCASUAL_UTILS_VECTOR_H
 
+#include "id.hpp"
 #include "os.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if MCL_CPU_AVX2
+#include <immintrin.h>
+#elif MCL_CPU_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace mcl::utils::container
 {
+namespace detail
+{
+/* SimdSearchable
+Element types whose equality can be tested on many elements at once: integers
+and Ids compare their bits, floating point numbers follow the usual IEEE rules
+(-0.0 == 0.0, NaN is never equal). */
+
+template <typename T>
+concept SimdSearchable = (std::is_arithmetic_v<T> || std::is_same_v<T, Id>) &&
+                         (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+template <typename R, typename V>
+concept SimdSearchableRange = std::ranges::contiguous_range<const R> && std::ranges::sized_range<const R> &&
+                              SimdSearchable<std::ranges::range_value_t<R>> &&
+                              std::is_same_v<std::remove_cvref_t<V>, std::ranges::range_value_t<R>>;
+
+#if MCL_CPU_AVX2
+
+using Vector = __m256i;
+
+inline Vector load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+inline Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline std::uint32_t getMask(Vector v) { return static_cast<std::uint32_t>(_mm256_movemask_epi8(v)); }
+
+template <typename T>
+Vector splat(T value)
+{
+	if constexpr (std::is_same_v<T, float>)
+		return _mm256_castps_si256(_mm256_set1_ps(value));
+	else if constexpr (std::is_same_v<T, double>)
+		return _mm256_castpd_si256(_mm256_set1_pd(value));
+	else if constexpr (sizeof(T) == 1)
+		return _mm256_set1_epi8(std::bit_cast<char>(value));
+	else if constexpr (sizeof(T) == 2)
+		return _mm256_set1_epi16(std::bit_cast<short>(value));
+	else if constexpr (sizeof(T) == 4)
+		return _mm256_set1_epi32(std::bit_cast<int>(value));
+	else
+		return _mm256_set1_epi64x(std::bit_cast<long long>(value));
+}
+
+template <typename T>
+Vector equal(Vector a, Vector b)
+{
+	if constexpr (std::is_same_v<T, float>)
+		return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ));
+	else if constexpr (std::is_same_v<T, double>)
+		return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ));
+	else if constexpr (sizeof(T) == 1)
+		return _mm256_cmpeq_epi8(a, b);
+	else if constexpr (sizeof(T) == 2)
+		return _mm256_cmpeq_epi16(a, b);
+	else if constexpr (sizeof(T) == 4)
+		return _mm256_cmpeq_epi32(a, b);
+	else
+		return _mm256_cmpeq_epi64(a, b);
+}
+
+#elif MCL_CPU_SSE2
+
+using Vector = __m128i;
+
+inline Vector load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+inline Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline std::uint32_t getMask(Vector v) { return static_cast<std::uint32_t>(_mm_movemask_epi8(v)); }
+
+template <typename T>
+Vector splat(T value)
+{
+	if constexpr (std::is_same_v<T, float>)
+		return _mm_castps_si128(_mm_set1_ps(value));
+	else if constexpr (std::is_same_v<T, double>)
+		return _mm_castpd_si128(_mm_set1_pd(value));
+	else if constexpr (sizeof(T) == 1)
+		return _mm_set1_epi8(std::bit_cast<char>(value));
+	else if constexpr (sizeof(T) == 2)
+		return _mm_set1_epi16(std::bit_cast<short>(value));
+	else if constexpr (sizeof(T) == 4)
+		return _mm_set1_epi32(std::bit_cast<int>(value));
+	else
+		return _mm_set1_epi64x(std::bit_cast<long long>(value));
+}
+
+template <typename T>
+Vector equal(Vector a, Vector b)
+{
+	if constexpr (std::is_same_v<T, float>)
+		return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+	else if constexpr (std::is_same_v<T, double>)
+		return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+	else if constexpr (sizeof(T) == 1)
+		return _mm_cmpeq_epi8(a, b);
+	else if constexpr (sizeof(T) == 2)
+		return _mm_cmpeq_epi16(a, b);
+	else if constexpr (sizeof(T) == 4)
+		return _mm_cmpeq_epi32(a, b);
+	else // No 64-bit compare in SSE2: both 32-bit halves must match
+	{
+		const Vector halves = _mm_cmpeq_epi32(a, b);
+		return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+	}
+}
+
+#endif
+
+/* find
+Returns the index of the first element equal to 'value', or 'size'. Compares a
+whole vector register (16 or 32 bytes) at a time, four registers per round to
+keep several loads in flight, then finishes with a scalar loop. */
+
+template <typename T>
+std::size_t find(const T* data, std::size_t size, T value) noexcept
+{
+	std::size_t i = 0;
+#if MCL_CPU_SSE2
+	constexpr std::size_t LANES  = sizeof(Vector) / sizeof(T);
+	const Vector          needle = splat(value);
+
+	for (; i + 4 * LANES <= size; i += 4 * LANES)
+	{
+		const Vector matches[] = {
+		    equal<T>(load(data + i), needle),
+		    equal<T>(load(data + i + LANES), needle),
+		    equal<T>(load(data + i + 2 * LANES), needle),
+		    equal<T>(load(data + i + 3 * LANES), needle)};
+		if (getMask(bitOr(bitOr(matches[0], matches[1]), bitOr(matches[2], matches[3]))) == 0)
+			continue;
+		for (std::size_t k = 0; k < 4; k++)
+			if (const std::uint32_t mask = getMask(matches[k]); mask != 0)
+				return i + k * LANES + static_cast<std::size_t>(std::countr_zero(mask)) / sizeof(T);
+	}
+	for (; i + LANES <= size; i += LANES)
+		if (const std::uint32_t mask = getMask(equal<T>(load(data + i), needle)); mask != 0)
+			return i + static_cast<std::size_t>(std::countr_zero(mask)) / sizeof(T);
+#endif
+	for (; i < size; i++)
+		if (data[i] == value)
+			return i;
+	return size;
+}
+
+/* anyOf
+Evaluates 'func' on blocks of one cache line without early exit, which the
+compiler can turn into vector code, and only checks for a match between
+blocks. */
+
+template <typename T, typename F>
+bool anyOf(const T* data, std::size_t size, F& func)
+{
+	constexpr std::size_t BLOCK = 64 / sizeof(T);
+
+	std::size_t i = 0;
+	for (; i + BLOCK <= size; i += BLOCK)
+	{
+		unsigned found = 0; // Not a bool: GCC doesn't vectorize reductions on those
+		for (std::size_t j = 0; j < BLOCK; j++)
+			found |= func(data[i + j]) ? 1u : 0u;
+		if (found != 0)
+			return true;
+	}
+	for (; i < size; i++)
+		if (func(data[i]))
+			return true;
+	return false;
+}
+} // namespace detail
+
+/* -------------------------------------------------------------------------- */
+
 /* indexOf
 Returns the index of element p in container/view 'v'. Returns v.size() if
-element is not found. */
+element is not found. Contiguous ranges of numbers or Ids, searched for a value
+of the same type, are scanned with SIMD instructions where available. */
 
 template <typename T, typename P>
 std::size_t indexOf(const T& v, const P& p)
 {
-	return static_cast<std::size_t>(std::distance(std::cbegin(v), std::find(std::cbegin(v), std::cend(v), p)));
+	if constexpr (detail::SimdSearchableRange<T, P>)
+		return detail::find(std::ranges::data(v), std::ranges::size(v), p);
+	else
+		return static_cast<std::size_t>(std::distance(std::cbegin(v), std::find(std::cbegin(v), std::cend(v), p)));
 }
 
 /* -------------------------------------------------------------------------- */
@@ -60,10 +254,59 @@ bool hasIf(const T& v, F&& func)
 	return findIf(v, func) != std::cend(v);
 }
 
+/* hasIfBlockwise
+Same as hasIf(), for contiguous ranges of numbers or Ids. Evaluates 'func' one
+cache line at a time so that the loop can be vectorized, i.e. it may be called
+on a few elements past the first match: use it only with predicates that have
+no side effects. */
+
+template <typename T, typename F>
+    requires std::ranges::contiguous_range<const T> && detail::SimdSearchable<std::ranges::range_value_t<T>>
+bool hasIfBlockwise(const T& v, F&& func)
+{
+	return detail::anyOf(std::ranges::data(v), std::ranges::size(v), func);
+}
+
 template <typename T, typename Target>
 bool has(const T& v, const Target& target)
 {
-	return std::find(std::cbegin(v), std::cend(v), target) != std::cend(v);
+	if constexpr (detail::SimdSearchableRange<T, Target>)
+		return detail::find(std::ranges::data(v), std::ranges::size(v), target) != std::ranges::size(v);
+	else
+		return std::find(std::cbegin(v), std::cend(v), target) != std::cend(v);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* sortedIndexOf
+Like indexOf, for random access ranges sorted in ascending order: returns the
+index of the first element equal to 'p' in O(log n). The binary search is
+branchless, i.e. the halving step compiles to a conditional move, so there
+are no mispredicted branches to pay for on random lookups. */
+
+template <typename T, typename P>
+std::size_t sortedIndexOf(const T& v, const P& p)
+{
+	const std::size_t size = std::ranges::size(v);
+	if (size == 0)
+		return 0;
+
+	const auto  first = std::ranges::cbegin(v);
+	std::size_t base  = 0;
+	for (std::size_t n = size; n > 1;)
+	{
+		const std::size_t half = n / 2;
+		base                   = first[base + half] < p ? base + half : base;
+		n -= half;
+	}
+	base += first[base] < p; // Lower bound
+	return base < size && first[base] == p ? base : size;
+}
+
+template <typename T, typename P>
+bool sortedHas(const T& v, const P& p)
+{
+	return sortedIndexOf(v, p) != std::ranges::size(v);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -86,12 +329,84 @@ void removeAt(T& v, std::size_t index)
 	v.erase(v.begin() + index);
 }
 
+/* removeAtUnordered
+Removes the element at 'index' in O(1), by moving the last element into its
+place. Doesn't preserve the order of the elements. */
+
+template <typename T>
+void removeAtUnordered(T& v, std::size_t index)
+{
+	if (index != v.size() - 1)
+		v[index] = std::move(v.back());
+	v.pop_back();
+}
+
+/* removeAtMany
+Removes the elements at 'indexes', which must be sorted in ascending order and
+within bounds (duplicates are fine). Runs in a single pass, moving each
+surviving element at most once, instead of O(n) per index as removeAt. */
+
+template <typename T, typename Indexes>
+void removeAtMany(T& v, const Indexes& indexes)
+{
+	auto first = std::begin(indexes);
+	auto last  = std::end(indexes);
+	if (first == last)
+		return;
+
+	auto out = v.begin() + *first;
+	while (first != last)
+	{
+		const auto from = static_cast<std::size_t>(*first) + 1;
+		while (first != last && static_cast<std::size_t>(*first) < from)
+			++first;
+		const auto to = first != last ? static_cast<std::size_t>(*first) : v.size();
+		out           = std::move(v.begin() + from, v.begin() + to, out);
+	}
+	v.erase(out, v.end());
+}
+
+/* removeIfUnordered
+Like removeIf, but fills each hole with an element from the back: only as
+many elements as removed are moved, instead of all the ones after the first
+hole. Doesn't preserve the order of the elements. */
+
+template <typename T, typename F>
+void removeIfUnordered(T& v, F&& func)
+{
+	auto first = v.begin();
+	auto last  = v.end();
+	while (first != last)
+	{
+		if (!func(*first))
+			++first;
+		else if (first != --last) // Check the replacement on the next round
+			*first = std::move(*last);
+	}
+	v.erase(last, v.end());
+}
+
 /* -------------------------------------------------------------------------- */
 
+/* cast (1)
+Copies the elements of 'i' into a new vector. Any other container that can be
+built from an iterator pair can be picked as 'Out', e.g. a SmallVector<T, N>
+to skip the allocation for short results. */
+
+template <typename T, typename Out = std::vector<T>, typename I>
+Out cast(const I& i)
+{
+	return Out(i.begin(), i.end());
+}
+
+/* cast (2)
+Same as (1), with the vector allocated from 'resource', e.g. a
+memory::ArenaResource on a real-time thread. */
+
 template <typename T, typename I>
-std::vector<T> cast(const I& i)
+std::pmr::vector<T> cast(const I& i, std::pmr::memory_resource* resource)
 {
-	return {i.begin(), i.end()};
+	return std::pmr::vector<T>(i.begin(), i.end(), resource);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -126,6 +441,1046 @@ auto enumerate(R&& r) noexcept
 	return std::views::enumerate(std::forward<R>(r));
 #endif
 }
+
+/* -------------------------------------------------------------------------- */
+
+/* InlineVector
+Vector with room for N elements inside the object itself, with the same
+interface as std::vector (the parts of it the algorithms above need, at least).
+Don't use it directly, pick one of the two flavors below. */
+
+template <typename T, std::size_t N, bool Growable>
+class InlineVector
+{
+	static_assert(N > 0, "Inline capacity must be greater than 0");
+
+public:
+	using value_type      = T;
+	using size_type       = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference       = T&;
+	using const_reference = const T&;
+	using pointer         = T*;
+	using const_pointer   = const T*;
+	using iterator        = T*;
+	using const_iterator  = const T*;
+
+	InlineVector() noexcept = default;
+
+	InlineVector(std::size_t count, const T& value)
+	{
+		reserve(count);
+		while (count-- > 0)
+			emplace_back(value);
+	}
+
+	template <std::input_iterator It>
+	InlineVector(It first, It last)
+	{
+		if constexpr (std::forward_iterator<It>)
+			reserve(static_cast<std::size_t>(std::distance(first, last)));
+		for (; first != last; ++first)
+			emplace_back(*first);
+	}
+
+	InlineVector(std::initializer_list<T> list)
+	: InlineVector(list.begin(), list.end())
+	{
+	}
+
+	InlineVector(const InlineVector& o)
+	: InlineVector(o.begin(), o.end())
+	{
+	}
+
+	InlineVector(InlineVector&& o) noexcept(std::is_nothrow_move_constructible_v<T>)
+	{
+		steal(o);
+	}
+
+	InlineVector& operator=(const InlineVector& o)
+	{
+		if (this != &o)
+		{
+			clear();
+			reserve(o.size());
+			for (const T& t : o)
+				emplace_back(t);
+		}
+		return *this;
+	}
+
+	InlineVector& operator=(InlineVector&& o) noexcept(std::is_nothrow_move_constructible_v<T>)
+	{
+		if (this != &o)
+		{
+			clear();
+			deallocate();
+			steal(o);
+		}
+		return *this;
+	}
+
+	~InlineVector()
+	{
+		clear();
+		deallocate();
+	}
+
+	iterator       begin() noexcept { return m_data; }
+	iterator       end() noexcept { return m_data + m_size; }
+	const_iterator begin() const noexcept { return m_data; }
+	const_iterator end() const noexcept { return m_data + m_size; }
+	const_iterator cbegin() const noexcept { return begin(); }
+	const_iterator cend() const noexcept { return end(); }
+
+	T*       data() noexcept { return m_data; }
+	const T* data() const noexcept { return m_data; }
+
+	std::size_t size() const noexcept { return m_size; }
+	std::size_t capacity() const noexcept { return m_capacity; }
+	bool        empty() const noexcept { return m_size == 0; }
+	bool        full() const noexcept { return m_size == m_capacity; }
+
+	/* isInline
+	Tells whether elements are still stored inside the object. Always true for
+	a StaticVector. */
+
+	bool isInline() const noexcept { return m_data == getInlineData(); }
+
+	T&       operator[](std::size_t i) noexcept { return m_data[i]; }
+	const T& operator[](std::size_t i) const noexcept { return m_data[i]; }
+	T&       front() noexcept { return m_data[0]; }
+	const T& front() const noexcept { return m_data[0]; }
+	T&       back() noexcept { return m_data[m_size - 1]; }
+	const T& back() const noexcept { return m_data[m_size - 1]; }
+
+	void reserve(std::size_t n)
+	{
+		if (n <= m_capacity)
+			return;
+		if constexpr (Growable)
+			reallocate(n);
+		else
+			throw std::bad_alloc();
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		if (m_size < m_capacity)
+			return *std::construct_at(m_data + m_size++, std::forward<Args>(args)...);
+		if constexpr (Growable)
+		{
+			T t(std::forward<Args>(args)...); // Args might refer to an element about to be moved
+			reallocate(m_capacity * 2);
+			return *std::construct_at(m_data + m_size++, std::move(t));
+		}
+		else
+			throw std::bad_alloc();
+	}
+
+	void push_back(const T& t) { emplace_back(t); }
+	void push_back(T&& t) { emplace_back(std::move(t)); }
+
+	/* tryEmplaceBack, tryPushBack
+	Like emplace_back and push_back, but return nullptr when full instead of
+	throwing (StaticVector) or growing (SmallVector). Pointer to the new
+	element otherwise. */
+
+	template <typename... Args>
+	T* tryEmplaceBack(Args&&... args)
+	{
+		if (m_size == m_capacity)
+			return nullptr;
+		return std::construct_at(m_data + m_size++, std::forward<Args>(args)...);
+	}
+
+	T* tryPushBack(const T& t) { return tryEmplaceBack(t); }
+	T* tryPushBack(T&& t) { return tryEmplaceBack(std::move(t)); }
+
+	void pop_back() noexcept { std::destroy_at(m_data + --m_size); }
+
+	iterator insert(const_iterator pos, T t)
+	{
+		const auto index = pos - begin();
+		emplace_back(std::move(t));
+		std::rotate(begin() + index, end() - 1, end());
+		return begin() + index;
+	}
+
+	iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		iterator from = begin() + (first - begin());
+		iterator to   = begin() + (last - begin());
+		if (from != to)
+		{
+			iterator newEnd = std::move(to, end(), from);
+			std::destroy(newEnd, end());
+			m_size = static_cast<std::size_t>(newEnd - begin());
+		}
+		return from;
+	}
+
+	void resize(std::size_t n) { resize(n, T()); }
+
+	void resize(std::size_t n, const T& value)
+	{
+		reserve(n);
+		while (m_size > n)
+			pop_back();
+		while (m_size < n)
+			emplace_back(value);
+	}
+
+	void clear() noexcept
+	{
+		std::destroy(begin(), end());
+		m_size = 0;
+	}
+
+	friend bool operator==(const InlineVector& a, const InlineVector& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end());
+	}
+
+private:
+	T*       getInlineData() noexcept { return reinterpret_cast<T*>(m_inline); }
+	const T* getInlineData() const noexcept { return reinterpret_cast<const T*>(m_inline); }
+
+	void reallocate(std::size_t n)
+	{
+		T* data = std::allocator<T>().allocate(n);
+		std::uninitialized_move(begin(), end(), data);
+		std::destroy(begin(), end());
+		deallocate();
+		m_data     = data;
+		m_capacity = n;
+	}
+
+	void deallocate() noexcept
+	{
+		if (!isInline())
+			std::allocator<T>().deallocate(m_data, m_capacity);
+		m_data     = getInlineData();
+		m_capacity = N;
+	}
+
+	/* steal
+	Takes the heap buffer of 'o' if there's one, otherwise moves the elements
+	one by one. Leaves 'o' empty. Expects this to be empty and inline. */
+
+	void steal(InlineVector& o)
+	{
+		if (!o.isInline())
+		{
+			m_data     = std::exchange(o.m_data, o.getInlineData());
+			m_capacity = std::exchange(o.m_capacity, N);
+			m_size     = std::exchange(o.m_size, 0);
+			return;
+		}
+		std::uninitialized_move(o.begin(), o.end(), m_data);
+		m_size = o.m_size;
+		o.clear();
+	}
+
+	alignas(T) std::byte m_inline[N * sizeof(T)];
+	T*          m_data     = getInlineData();
+	std::size_t m_size     = 0;
+	std::size_t m_capacity = N;
+};
+
+/* SmallVector
+Keeps up to N elements inline, moves them to the heap beyond that. Best when
+most instances are small: those don't allocate at all. */
+
+template <typename T, std::size_t N>
+using SmallVector = InlineVector<T, N, true>;
+
+/* StaticVector
+Holds at most N elements and never allocates. Going over capacity throws
+std::bad_alloc; tryPushBack() and tryEmplaceBack() report it by returning
+nullptr instead, for code that can't deal with exceptions. */
+
+template <typename T, std::size_t N>
+using StaticVector = InlineVector<T, N, false>;
+
+/* -------------------------------------------------------------------------- */
+
+/* SlotMap
+Container of T with O(1) insertion, removal and lookup through Id keys. Elements
+are packed contiguously (removal moves the last one into the hole), so
+iteration touches live elements only. Each key encodes a slot index plus a
+generation counter, which is bumped whenever the slot is freed: stale keys are
+detected and never alias newer elements. Keys are always valid Ids. After
+reserve(n), up to n elements can be held without any further allocation. */
+
+template <typename T>
+class SlotMap
+{
+public:
+	using value_type     = T;
+	using iterator       = typename std::vector<T>::iterator;
+	using const_iterator = typename std::vector<T>::const_iterator;
+
+	void reserve(std::size_t n)
+	{
+		m_data.reserve(n);
+		m_dataToSlot.reserve(n);
+		m_slots.reserve(n);
+	}
+
+	std::size_t size() const noexcept { return m_data.size(); }
+	bool        empty() const noexcept { return m_data.empty(); }
+	std::size_t capacity() const noexcept { return m_data.capacity(); }
+
+	iterator       begin() noexcept { return m_data.begin(); }
+	iterator       end() noexcept { return m_data.end(); }
+	const_iterator begin() const noexcept { return m_data.begin(); }
+	const_iterator end() const noexcept { return m_data.end(); }
+
+	/* getData
+	Returns all live elements, in no particular order. */
+
+	std::span<T>       getData() noexcept { return m_data; }
+	std::span<const T> getData() const noexcept { return m_data; }
+
+	/* getKey
+	Returns the key of the i-th element in getData(). */
+
+	Id getKey(std::size_t i) const noexcept
+	{
+		const std::uint32_t slotIndex = m_dataToSlot[i];
+		return makeKey(slotIndex, m_slots[slotIndex].generation);
+	}
+
+	template <typename... Args>
+	Id emplace(Args&&... args)
+	{
+		const std::uint32_t dataIndex = static_cast<std::uint32_t>(m_data.size());
+		m_data.emplace_back(std::forward<Args>(args)...);
+
+		std::uint32_t slotIndex;
+		if (m_freeHead != NO_SLOT)
+		{
+			slotIndex  = m_freeHead;
+			m_freeHead = m_slots[slotIndex].index;
+		}
+		else
+		{
+			slotIndex = static_cast<std::uint32_t>(m_slots.size());
+			m_slots.push_back({0, 1});
+		}
+		m_slots[slotIndex].index = dataIndex;
+		m_dataToSlot.push_back(slotIndex);
+
+		return makeKey(slotIndex, m_slots[slotIndex].generation);
+	}
+
+	Id insert(const T& t) { return emplace(t); }
+	Id insert(T&& t) { return emplace(std::move(t)); }
+
+	/* erase
+	Removes the element with key 'key'. Returns false if the key is stale or
+	invalid. */
+
+	bool erase(Id key)
+	{
+		const std::uint32_t slotIndex = findSlot(key);
+		if (slotIndex == NO_SLOT)
+			return false;
+
+		const std::uint32_t dataIndex = m_slots[slotIndex].index;
+		const std::uint32_t lastIndex = static_cast<std::uint32_t>(m_data.size() - 1);
+		if (dataIndex != lastIndex)
+		{
+			m_data[dataIndex]                      = std::move(m_data[lastIndex]);
+			m_dataToSlot[dataIndex]                = m_dataToSlot[lastIndex];
+			m_slots[m_dataToSlot[dataIndex]].index = dataIndex;
+		}
+		m_data.pop_back();
+		m_dataToSlot.pop_back();
+
+		Slot& slot = m_slots[slotIndex];
+		if (++slot.generation > MAX_GENERATION)
+			slot.generation = 1;
+		slot.index = m_freeHead;
+		m_freeHead = slotIndex;
+		return true;
+	}
+
+	void clear() noexcept
+	{
+		while (!m_data.empty())
+			erase(getKey(m_data.size() - 1));
+	}
+
+	bool contains(Id key) const noexcept { return findSlot(key) != NO_SLOT; }
+
+	/* get
+	Returns a pointer to the element with key 'key', or nullptr if the key is
+	stale or invalid. */
+
+	T* get(Id key) noexcept
+	{
+		const std::uint32_t slotIndex = findSlot(key);
+		return slotIndex == NO_SLOT ? nullptr : &m_data[m_slots[slotIndex].index];
+	}
+
+	const T* get(Id key) const noexcept
+	{
+		return const_cast<SlotMap*>(this)->get(key);
+	}
+
+private:
+	/* Slot
+	Indirection between keys and packed data. 'index' points into m_data for
+	live slots, or to the next free slot for free ones. */
+
+	struct Slot
+	{
+		std::uint32_t index;
+		std::uint32_t generation;
+	};
+
+	/* Keys are split in two halves: slot index in the lower one, generation
+	(never 0, so that keys are always valid Ids) in the upper one. */
+
+	static constexpr std::size_t   KEY_SHIFT      = std::numeric_limits<std::size_t>::digits / 2;
+	static constexpr std::size_t   KEY_MASK       = (std::size_t{1} << KEY_SHIFT) - 1;
+	static constexpr std::uint32_t MAX_GENERATION = static_cast<std::uint32_t>(std::min<std::size_t>(KEY_MASK, std::numeric_limits<std::uint32_t>::max()));
+	static constexpr std::uint32_t NO_SLOT        = std::numeric_limits<std::uint32_t>::max();
+
+	static Id makeKey(std::uint32_t slotIndex, std::uint32_t generation) noexcept
+	{
+		return Id{(static_cast<std::size_t>(generation) << KEY_SHIFT) | slotIndex};
+	}
+
+	std::uint32_t findSlot(Id key) const noexcept
+	{
+		const std::size_t   value      = key.getValue();
+		const std::size_t   slotIndex  = value & KEY_MASK;
+		const std::uint32_t generation = static_cast<std::uint32_t>(value >> KEY_SHIFT);
+		if (slotIndex >= m_slots.size() || generation == 0 || m_slots[slotIndex].generation != generation)
+			return NO_SLOT;
+		return static_cast<std::uint32_t>(slotIndex);
+	}
+
+	std::vector<T>             m_data;
+	std::vector<std::uint32_t> m_dataToSlot;
+	std::vector<Slot>          m_slots;
+	std::uint32_t              m_freeHead = NO_SLOT;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* IdMap
+Flat hash map from Id to V, an alternative to std::unordered_map<Id, V> with no
+per-element allocations. Open addressing with linear probing: each slot has a
+one-byte control word holding 7 bits of the hash, and lookups compare 16 of
+them at a time (with SSE2, where available) before touching any key. Erase uses
+backward-shift deletion, so there are no tombstones and probe sequences never
+degrade over time. The hash is Fibonacci hashing, which spreads sequential Ids
+evenly across the table. After reserve(n), up to n elements can be inserted
+without rehashing. Pointers to values are invalidated by insertion (on rehash)
+and by erase. */
+
+template <typename V>
+class IdMap
+{
+public:
+	IdMap() = default;
+
+	explicit IdMap(std::size_t n)
+	{
+		reserve(n);
+	}
+
+	IdMap(const IdMap& o)
+	{
+		reserve(o.size());
+		o.forEach([this](Id key, const V& value) { emplace(key, value); });
+	}
+
+	IdMap(IdMap&& o) noexcept
+	{
+		swap(o);
+	}
+
+	IdMap& operator=(IdMap o) noexcept
+	{
+		swap(o);
+		return *this;
+	}
+
+	~IdMap()
+	{
+		clear();
+	}
+
+	void swap(IdMap& o) noexcept
+	{
+		std::swap(m_ctrl, o.m_ctrl);
+		std::swap(m_slots, o.m_slots);
+		std::swap(m_capacity, o.m_capacity);
+		std::swap(m_size, o.m_size);
+		std::swap(m_shift, o.m_shift);
+	}
+
+	std::size_t size() const noexcept { return m_size; }
+	bool        empty() const noexcept { return m_size == 0; }
+
+	/* capacity
+	Number of elements the map can hold before rehashing. */
+
+	std::size_t capacity() const noexcept { return maxLoad(m_capacity); }
+
+	/* reserve
+	Makes room for at least 'n' elements, so that inserting up to 'n' elements
+	never rehashes nor allocates. */
+
+	void reserve(std::size_t n)
+	{
+		if (n <= capacity())
+			return;
+		std::size_t newCapacity = MIN_CAPACITY;
+		while (maxLoad(newCapacity) < n)
+			newCapacity *= 2;
+		rehash(newCapacity);
+	}
+
+	/* emplace
+	Inserts a new element constructed from 'args', unless 'key' is already
+	there. Returns a pointer to the element with that key and whether the
+	insertion took place. */
+
+	template <typename... Args>
+	std::pair<V*, bool> emplace(Id key, Args&&... args)
+	{
+		if (V* value = find(key); value != nullptr)
+			return {value, false};
+
+		if (m_size + 1 > capacity())
+			reserve(m_size + 1);
+
+		const std::uint64_t hash = hashOf(key);
+		std::size_t         pos  = homeOf(hash);
+		while (true)
+		{
+			if (const std::uint32_t empties = matchEmpty(pos); empties != 0)
+			{
+				const std::size_t i = (pos + std::countr_zero(empties)) & (m_capacity - 1);
+				::new (static_cast<void*>(&m_slots[i])) Slot{key, V(std::forward<Args>(args)...)};
+				setCtrl(i, static_cast<std::int8_t>(hash & 0x7F));
+				m_size++;
+				return {&m_slots[i].value, true};
+			}
+			pos = (pos + GROUP_SIZE) & (m_capacity - 1);
+		}
+	}
+
+	V& operator[](Id key)
+	    requires std::default_initializable<V>
+	{
+		return *emplace(key).first;
+	}
+
+	V* find(Id key) noexcept
+	{
+		const std::size_t i = findIndex(key);
+		return i == NOT_FOUND ? nullptr : &m_slots[i].value;
+	}
+
+	const V* find(Id key) const noexcept
+	{
+		return const_cast<IdMap*>(this)->find(key);
+	}
+
+	bool contains(Id key) const noexcept { return find(key) != nullptr; }
+
+	/* erase
+	Removes the element with key 'key', if any. Following elements in the same
+	probe sequence are shifted back to fill the hole. */
+
+	bool erase(Id key)
+	{
+		std::size_t hole = findIndex(key);
+		if (hole == NOT_FOUND)
+			return false;
+
+		const std::size_t mask = m_capacity - 1;
+		m_slots[hole].~Slot();
+
+		for (std::size_t i = (hole + 1) & mask; m_ctrl[i] != EMPTY; i = (i + 1) & mask)
+		{
+			const std::size_t home = homeOf(hashOf(m_slots[i].key));
+			if (((i - home) & mask) < ((i - hole) & mask))
+				continue; // Element's home lies between the hole and its position
+			::new (static_cast<void*>(&m_slots[hole])) Slot(std::move(m_slots[i]));
+			m_slots[i].~Slot();
+			setCtrl(hole, m_ctrl[i]);
+			hole = i;
+		}
+
+		setCtrl(hole, EMPTY);
+		m_size--;
+		return true;
+	}
+
+	/* clear
+	Removes all elements, keeping the allocated memory. */
+
+	void clear() noexcept
+	{
+		for (std::size_t i = 0; i < m_capacity; i++)
+			if (m_ctrl[i] != EMPTY)
+				m_slots[i].~Slot();
+		if (m_ctrl != nullptr)
+			std::memset(m_ctrl.get(), EMPTY, m_capacity + GROUP_SIZE);
+		m_size = 0;
+	}
+
+	/* forEach
+	Calls 'f(Id, V&)' on each element, in no particular order. */
+
+	template <typename F>
+	void forEach(F&& f)
+	{
+		for (std::size_t i = 0; i < m_capacity; i++)
+			if (m_ctrl[i] != EMPTY)
+				f(m_slots[i].key, m_slots[i].value);
+	}
+
+	template <typename F>
+	void forEach(F&& f) const
+	{
+		for (std::size_t i = 0; i < m_capacity; i++)
+			if (m_ctrl[i] != EMPTY)
+				f(m_slots[i].key, static_cast<const V&>(m_slots[i].value));
+	}
+
+private:
+	struct Slot
+	{
+		Id key;
+		V  value;
+	};
+
+	/* Control bytes: EMPTY, or the lower 7 bits of the hash for full slots. The
+	first GROUP_SIZE bytes are mirrored past the end of the table, so that a
+	group can always be loaded with a single unaligned read. */
+
+	static constexpr std::int8_t EMPTY        = -128;
+	static constexpr std::size_t GROUP_SIZE   = 16;
+	static constexpr std::size_t MIN_CAPACITY = GROUP_SIZE;
+	static constexpr std::size_t NOT_FOUND    = std::numeric_limits<std::size_t>::max();
+
+	static constexpr std::size_t maxLoad(std::size_t capacity) noexcept
+	{
+		return capacity - capacity / 8; // 87.5%
+	}
+
+	static constexpr std::uint64_t hashOf(Id key) noexcept
+	{
+		const std::uint64_t v = static_cast<std::uint64_t>(key.getValue());
+		return (v ^ (v >> 32)) * 0x9E3779B97F4A7C15ull;
+	}
+
+	/* homeOf
+	Fibonacci hashing: the top bits of the product give the home slot. */
+
+	std::size_t homeOf(std::uint64_t hash) const noexcept
+	{
+		return static_cast<std::size_t>(hash >> m_shift);
+	}
+
+	std::size_t findIndex(Id key) const noexcept
+	{
+		if (m_size == 0)
+			return NOT_FOUND;
+
+		const std::uint64_t hash = hashOf(key);
+		const std::int8_t   h2   = static_cast<std::int8_t>(hash & 0x7F);
+		std::size_t         pos  = homeOf(hash);
+		while (true)
+		{
+			for (std::uint32_t matches = match(pos, h2); matches != 0; matches &= matches - 1)
+			{
+				const std::size_t i = (pos + std::countr_zero(matches)) & (m_capacity - 1);
+				if (m_slots[i].key == key)
+					return i;
+			}
+			if (matchEmpty(pos) != 0)
+				return NOT_FOUND;
+			pos = (pos + GROUP_SIZE) & (m_capacity - 1);
+		}
+	}
+
+	void setCtrl(std::size_t i, std::int8_t c) noexcept
+	{
+		m_ctrl[i] = c;
+		if (i < GROUP_SIZE)
+			m_ctrl[m_capacity + i] = c;
+	}
+
+	/* match, matchEmpty
+	Return a bitmask of the slots in the group starting at 'pos' whose control
+	byte is 'c' (or EMPTY). */
+
+	std::uint32_t match(std::size_t pos, std::int8_t c) const noexcept
+	{
+#if MCL_CPU_SSE2
+		const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_ctrl.get() + pos));
+		return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(c))));
+#else
+		std::uint32_t mask = 0;
+		for (std::size_t i = 0; i < GROUP_SIZE; i++)
+			mask |= static_cast<std::uint32_t>(m_ctrl[pos + i] == c) << i;
+		return mask;
+#endif
+	}
+
+	std::uint32_t matchEmpty(std::size_t pos) const noexcept
+	{
+		return match(pos, EMPTY);
+	}
+
+	void rehash(std::size_t newCapacity)
+	{
+		IdMap other;
+		other.m_ctrl     = std::make_unique<std::int8_t[]>(newCapacity + GROUP_SIZE);
+		other.m_slots.reset(static_cast<Slot*>(::operator new(sizeof(Slot) * newCapacity, std::align_val_t{alignof(Slot)})));
+		other.m_capacity = newCapacity;
+		other.m_shift    = 64 - std::countr_zero(newCapacity);
+		std::memset(other.m_ctrl.get(), EMPTY, newCapacity + GROUP_SIZE);
+
+		forEach([&other](Id key, V& value) { other.emplace(key, std::move(value)); });
+		swap(other);
+	}
+
+	/* SlotsDeleter
+	Slots are raw, uninitialized memory: elements are constructed and destroyed
+	in place according to their control byte. */
+
+	struct SlotsDeleter
+	{
+		void operator()(Slot* p) const noexcept
+		{
+			::operator delete(p, std::align_val_t{alignof(Slot)});
+		}
+	};
+
+	std::unique_ptr<std::int8_t[]>       m_ctrl;
+	std::unique_ptr<Slot[], SlotsDeleter> m_slots;
+	std::size_t                          m_capacity = 0;
+	std::size_t                          m_size     = 0;
+	int                                  m_shift    = 64;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* RingBuffer
+Bounded, wait-free queue for exactly one producer thread and one consumer
+thread, e.g. events between the audio thread and the UI. Head and tail indices
+live on separate cache lines, and each side keeps a private copy of the other
+side's index, refreshed only when the queue looks full (or empty): in steady
+state a push or pop touches no shared cache line but its own. Indices grow
+monotonically and are mapped to slots with a mask, so capacity is rounded up to
+a power of two. Besides single and bulk push/pop, the claim API gives direct
+access to contiguous slots, for zero-copy producers and consumers (e.g. audio
+blocks): claim a region, fill or read it, then commit. T must be default
+constructible; slots keep their last value until overwritten. */
+
+template <typename T>
+class RingBuffer
+{
+public:
+	explicit RingBuffer(std::size_t capacity)
+	: m_capacity(std::bit_ceil(std::max<std::size_t>(capacity, 1)))
+	, m_mask(m_capacity - 1)
+	, m_data(std::make_unique<T[]>(m_capacity))
+	{
+	}
+
+	RingBuffer(const RingBuffer&)            = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	/* size, empty
+	Exact when called from the producer or the consumer while the other side is
+	idle, a snapshot otherwise. */
+
+	std::size_t size() const noexcept
+	{
+		const std::size_t head = m_consumer.head.load(std::memory_order_acquire);
+		const std::size_t tail = m_producer.tail.load(std::memory_order_acquire);
+		return tail - head;
+	}
+
+	bool empty() const noexcept { return size() == 0; }
+
+	/* Producer side ------------------------------------------------------- */
+
+	bool push(const T& t) { return emplace(t); }
+	bool push(T&& t) { return emplace(std::move(t)); }
+
+	/* emplace
+	Assigns a T built from 'args' to the next slot. Returns false if full. */
+
+	template <typename... Args>
+	bool emplace(Args&&... args)
+	{
+		const std::size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+		if (getWritable(tail, 1) == 0)
+			return false;
+		m_data[tail & m_mask] = T(std::forward<Args>(args)...);
+		m_producer.tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* push (bulk)
+	Copies as many elements of 'in' as fit. Returns how many. */
+
+	std::size_t push(std::span<const T> in)
+	{
+		const std::size_t tail  = m_producer.tail.load(std::memory_order_relaxed);
+		const std::size_t count = std::min(in.size(), getWritable(tail, in.size()));
+		const std::size_t first = std::min(count, m_capacity - (tail & m_mask)); // Up to the end of the storage
+		std::copy_n(in.begin(), first, m_data.get() + (tail & m_mask));
+		std::copy_n(in.begin() + first, count - first, m_data.get());
+		m_producer.tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+	/* claimWrite
+	Returns up to 'max' contiguous free slots. May be shorter than the free
+	space, when it wraps around the end of the storage: claim again after
+	committing to get the rest. Publish the slots with commitWrite(). */
+
+	std::span<T> claimWrite(std::size_t max = std::numeric_limits<std::size_t>::max())
+	{
+		const std::size_t tail  = m_producer.tail.load(std::memory_order_relaxed);
+		const std::size_t index = tail & m_mask;
+		return {m_data.get() + index, std::min({max, getWritable(tail, max), m_capacity - index})};
+	}
+
+	/* commitWrite
+	Makes the first 'count' slots of the last claimWrite() visible to the
+	consumer. */
+
+	void commitWrite(std::size_t count)
+	{
+		const std::size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+		assert(tail + count - m_producer.cachedHead <= m_capacity);
+		m_producer.tail.store(tail + count, std::memory_order_release);
+	}
+
+	/* Consumer side ------------------------------------------------------- */
+
+	/* pop
+	Moves the oldest element into 'out'. Returns false if empty. */
+
+	bool pop(T& out)
+	{
+		const std::size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		if (getReadable(head, 1) == 0)
+			return false;
+		out = std::move(m_data[head & m_mask]);
+		m_consumer.head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* pop (bulk)
+	Moves as many elements as available into 'out'. Returns how many. */
+
+	std::size_t pop(std::span<T> out)
+	{
+		const std::size_t head  = m_consumer.head.load(std::memory_order_relaxed);
+		const std::size_t count = std::min(out.size(), getReadable(head, out.size()));
+		const std::size_t first = std::min(count, m_capacity - (head & m_mask));
+		std::move(m_data.get() + (head & m_mask), m_data.get() + (head & m_mask) + first, out.begin());
+		std::move(m_data.get(), m_data.get() + (count - first), out.begin() + first);
+		m_consumer.head.store(head + count, std::memory_order_release);
+		return count;
+	}
+
+	/* claimRead
+	Returns up to 'max' contiguous readable slots, with the same wrap-around
+	caveat as claimWrite(). Release them with commitRead(). */
+
+	std::span<T> claimRead(std::size_t max = std::numeric_limits<std::size_t>::max())
+	{
+		const std::size_t head  = m_consumer.head.load(std::memory_order_relaxed);
+		const std::size_t index = head & m_mask;
+		return {m_data.get() + index, std::min({max, getReadable(head, max), m_capacity - index})};
+	}
+
+	void commitRead(std::size_t count)
+	{
+		const std::size_t head = m_consumer.head.load(std::memory_order_relaxed);
+		assert(head + count <= m_consumer.cachedTail);
+		m_consumer.head.store(head + count, std::memory_order_release);
+	}
+
+private:
+	/* getWritable
+	Returns the free space seen by the producer. The consumer's index is
+	reloaded only when the cached one doesn't leave room for 'wanted' slots. */
+
+	std::size_t getWritable(std::size_t tail, std::size_t wanted)
+	{
+		std::size_t free = m_capacity - (tail - m_producer.cachedHead);
+		if (free < wanted)
+		{
+			m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+			free                  = m_capacity - (tail - m_producer.cachedHead);
+		}
+		return free;
+	}
+
+	/* getReadable
+	Same as getWritable(), for the consumer. */
+
+	std::size_t getReadable(std::size_t head, std::size_t wanted)
+	{
+		std::size_t available = m_consumer.cachedTail - head;
+		if (available < wanted)
+		{
+			m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+			available             = m_consumer.cachedTail - head;
+		}
+		return available;
+	}
+
+	struct alignas(MCL_CACHE_LINE_SIZE) Producer
+	{
+		std::atomic<std::size_t> tail{0};
+		std::size_t              cachedHead = 0;
+	};
+
+	struct alignas(MCL_CACHE_LINE_SIZE) Consumer
+	{
+		std::atomic<std::size_t> head{0};
+		std::size_t              cachedTail = 0;
+	};
+
+	const std::size_t    m_capacity;
+	const std::size_t    m_mask;
+	std::unique_ptr<T[]> m_data;
+	Producer             m_producer;
+	Consumer             m_consumer;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* MpmcQueue
+Bounded queue for any number of producer and consumer threads, after Dmitry
+Vyukov's design: each slot carries a sequence number telling whether it's
+ready to be written or read in the current lap, so that producers and
+consumers only contend on their own index, with a single CAS per operation and
+no locks. Capacity is rounded up to a power of two. T must be default
+constructible. */
+
+template <typename T>
+class MpmcQueue
+{
+public:
+	explicit MpmcQueue(std::size_t capacity)
+	: m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+	, m_cells(std::make_unique<Cell[]>(m_mask + 1))
+	{
+		for (std::size_t i = 0; i <= m_mask; i++)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	MpmcQueue(const MpmcQueue&)            = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	std::size_t capacity() const noexcept { return m_mask + 1; }
+
+	/* size
+	A snapshot, possibly stale by the time it's returned. */
+
+	std::size_t size() const noexcept
+	{
+		const std::size_t head = m_dequeuePos.load(std::memory_order_acquire);
+		const std::size_t tail = m_enqueuePos.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+
+	bool push(const T& t) { return emplace(t); }
+	bool push(T&& t) { return emplace(std::move(t)); }
+
+	/* emplace
+	Returns false if full. */
+
+	template <typename... Args>
+	bool emplace(Args&&... args)
+	{
+		std::size_t pos  = m_enqueuePos.load(std::memory_order_relaxed);
+		Cell*       cell = nullptr;
+		while (true)
+		{
+			cell                       = &m_cells[pos & m_mask];
+			const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const auto        diff     = static_cast<std::ptrdiff_t>(sequence - pos);
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) // Slot still holds an element from the previous lap
+				return false;
+			else
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+		cell->data = T(std::forward<Args>(args)...);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* pop
+	Moves the oldest element into 'out'. Returns false if empty. */
+
+	bool pop(T& out)
+	{
+		std::size_t pos  = m_dequeuePos.load(std::memory_order_relaxed);
+		Cell*       cell = nullptr;
+		while (true)
+		{
+			cell                       = &m_cells[pos & m_mask];
+			const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const auto        diff     = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+			if (diff == 0)
+			{
+				if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) // Not written yet in this lap
+				return false;
+			else
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+		}
+		out = std::move(cell->data);
+		cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<std::size_t> sequence;
+		T                        data;
+	};
+
+	const std::size_t                                     m_mask;
+	std::unique_ptr<Cell[]>                               m_cells;
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> m_enqueuePos{0};
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> m_dequeuePos{0};
+};
 } // namespace mcl::utils::container
 
 #endif
@@ -25,16 +25,47 @@
  * -------------------------------------------------------------------------- */
 
 #include "os.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <climits>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #if MCL_OS_MAC
 #include <libgen.h> // basename unix
 #include <pwd.h>    // getpwuid
 #include <unistd.h> // getuid
 #endif
+#if MCL_OS_LINUX || MCL_OS_FREEBSD || MCL_OS_MAC
+#include <dirent.h>   // opendir, readdir
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, madvise
+#include <sys/stat.h> // stat
+#include <unistd.h>   // read, close
+#endif
+#if MCL_OS_LINUX
+#include <linux/io_uring.h> // io_uring_*
+#include <poll.h>           // poll
+#include <sys/eventfd.h>    // eventfd
+#include <sys/inotify.h>    // inotify_*
+#include <sys/syscall.h>    // syscall
+#include <sys/uio.h>        // iovec
+#endif
 #if MCL_OS_WINDOWS
+#include <fstream>
 #include <shlobj.h> // SHGetKnownFolderPath
 #endif
 #include "fs.hpp"
@@ -58,6 +89,607 @@ std::string getEnvVariable_(const char* s)
 }
 
 #endif
+
+/* -------------------------------------------------------------------------- */
+
+constexpr bool isSeparator_(char c)
+{
+#if MCL_OS_WINDOWS
+	return c == '\\' || c == '/';
+#else
+	return c == '/';
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* getRootLength_
+Returns the length of the root of path 's' (e.g. '/', 'C:\\'), if any. Only the
+first separator is counted, like std::filesystem does. */
+
+std::size_t getRootLength_(std::string_view s)
+{
+	std::size_t length = 0;
+#if MCL_OS_WINDOWS
+	if (s.size() >= 2 && s[1] == ':')
+		length = 2;
+#endif
+	if (length < s.size() && isSeparator_(s[length]))
+		length++;
+	return length;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t findLastSeparator_(std::string_view s)
+{
+	for (std::size_t i = s.size(); i > 0; i--)
+		if (isSeparator_(s[i - 1]))
+			return i - 1;
+	return std::string_view::npos;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Scanner_
+Engine behind scan(). Directories to visit go in a shared stack, consumed by a
+pool of worker threads; each worker collects matching files in a local batch
+and hands it to the callback when full. The scan is over when no directory is
+queued nor being read. */
+
+class Scanner_
+{
+public:
+	Scanner_(const ScanOptions& options, const ScanCallback& callback)
+	: m_options(options)
+	, m_callback(callback)
+	{
+		for (std::string& ext : m_options.extensions)
+			std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+		if (m_options.batchSize == 0)
+			m_options.batchSize = 1;
+	}
+
+	std::size_t run(const std::string& root)
+	{
+		push({root});
+
+		std::size_t threads = m_options.threads != 0 ? m_options.threads : std::thread::hardware_concurrency();
+		threads             = std::max<std::size_t>(threads, 1);
+
+		std::vector<std::thread> workers;
+		for (std::size_t i = 1; i < threads; i++)
+			workers.emplace_back([this]() { work(); });
+		work();
+		for (std::thread& t : workers)
+			t.join();
+
+		return m_count.load();
+	}
+
+private:
+	void work()
+	{
+		std::vector<std::string> batch;
+		std::vector<std::string> subdirs;
+		batch.reserve(m_options.batchSize);
+
+		while (true)
+		{
+			std::string dir;
+			{
+				std::unique_lock lock(m_mutex);
+				m_cond.wait(lock, [this]() { return !m_queue.empty() || m_pending == 0; });
+				if (m_queue.empty())
+					break;
+				dir = std::move(m_queue.back());
+				m_queue.pop_back();
+			}
+
+			readDir(dir, batch, subdirs);
+			push(subdirs);
+			subdirs.clear();
+
+			std::scoped_lock lock(m_mutex);
+			if (--m_pending == 0)
+				m_cond.notify_all();
+		}
+
+		flush(batch);
+	}
+
+	void push(std::vector<std::string>& dirs)
+	{
+		if (dirs.empty())
+			return;
+		{
+			std::scoped_lock lock(m_mutex);
+			m_pending += dirs.size();
+			for (std::string& dir : dirs)
+				m_queue.push_back(std::move(dir));
+		}
+		m_cond.notify_all();
+	}
+
+	void push(std::vector<std::string>&& dirs)
+	{
+		push(dirs);
+	}
+
+	void addFile(std::string path, std::vector<std::string>& batch)
+	{
+		batch.push_back(std::move(path));
+		if (batch.size() >= m_options.batchSize)
+			flush(batch);
+	}
+
+	void flush(std::vector<std::string>& batch)
+	{
+		if (batch.empty())
+			return;
+		m_count += batch.size();
+		{
+			std::scoped_lock lock(m_callbackMutex);
+			m_callback(batch);
+		}
+		batch.clear();
+	}
+
+	bool matches(std::string_view name) const
+	{
+		if (m_options.extensions.empty())
+			return true;
+		for (const std::string& ext : m_options.extensions)
+		{
+			if (name.size() < ext.size())
+				continue;
+			const std::string_view tail = name.substr(name.size() - ext.size());
+			if (std::equal(tail.begin(), tail.end(), ext.begin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == b; }))
+				return true;
+		}
+		return false;
+	}
+
+#if MCL_OS_LINUX || MCL_OS_FREEBSD || MCL_OS_MAC
+
+	/* readDir (POSIX)
+	Relies on dirent::d_type; stat() is only called for symlinks, and lstat()
+	for file systems that don't fill it (DT_UNKNOWN). */
+
+	void readDir(const std::string& dir, std::vector<std::string>& batch, std::vector<std::string>& subdirs)
+	{
+		if (m_options.followSymlinks && !markVisited(dir))
+			return;
+
+		DIR* d = opendir(dir.c_str());
+		if (d == nullptr)
+			return;
+
+		const std::string prefix = dir.ends_with('/') ? dir : dir + '/';
+		while (const dirent* entry = readdir(d))
+		{
+			const std::string_view name = entry->d_name;
+			if (name == "." || name == "..")
+				continue;
+
+			unsigned char type = entry->d_type;
+			if (type == DT_DIR || (type == DT_REG && !matches(name)))
+			{
+				if (type == DT_DIR)
+					subdirs.push_back(prefix + entry->d_name);
+				continue;
+			}
+
+			std::string path = prefix + entry->d_name;
+			struct stat st;
+			if (type == DT_UNKNOWN) // lstat(), so that symlinks follow the same rules as DT_LNK below
+			{
+				if (::lstat(path.c_str(), &st) != 0)
+					continue;
+				type = S_ISLNK(st.st_mode) ? DT_LNK : S_ISDIR(st.st_mode) ? DT_DIR
+				                                  : S_ISREG(st.st_mode)   ? DT_REG
+				                                                          : DT_UNKNOWN;
+				if (type == DT_DIR)
+				{
+					subdirs.push_back(std::move(path));
+					continue;
+				}
+			}
+			if (type == DT_LNK)
+			{
+				if (::stat(path.c_str(), &st) != 0)
+					continue;
+				if (S_ISDIR(st.st_mode))
+				{
+					if (m_options.followSymlinks)
+						subdirs.push_back(std::move(path));
+					continue;
+				}
+				type = S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+			}
+
+			if (type == DT_REG && matches(name))
+				addFile(std::move(path), batch);
+		}
+		closedir(d);
+	}
+
+	/* markVisited
+	Protects against symlink loops: returns false if the directory (as a
+	device/inode pair) has already been visited. */
+
+	bool markVisited(const std::string& dir)
+	{
+		struct stat st;
+		if (::stat(dir.c_str(), &st) != 0)
+			return false;
+		std::scoped_lock lock(m_mutex);
+		return m_visited.insert({static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino)}).second;
+	}
+
+	std::set<std::pair<std::uint64_t, std::uint64_t>> m_visited;
+
+#else
+
+	/* readDir (generic)
+	std::filesystem based. On Windows the directory iterator already caches the
+	file attributes, so no extra system call is needed per entry. */
+
+	void readDir(const std::string& dir, std::vector<std::string>& batch, std::vector<std::string>& subdirs)
+	{
+		std::error_code ec;
+		for (stdfs::directory_iterator it(dir, stdfs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec))
+		{
+			const bool isSymlink = it->is_symlink(ec);
+			if (it->is_directory(ec))
+			{
+				if (!isSymlink || m_options.followSymlinks)
+					subdirs.push_back(it->path().string());
+			}
+			else if (it->is_regular_file(ec))
+			{
+				std::string path = it->path().string();
+				if (matches(path))
+					addFile(std::move(path), batch);
+			}
+		}
+	}
+
+#endif
+
+	ScanOptions         m_options;
+	const ScanCallback& m_callback;
+
+	std::mutex               m_mutex; // Guards queue, pending count and visited set
+	std::condition_variable  m_cond;
+	std::vector<std::string> m_queue;
+	std::size_t              m_pending = 0;
+
+	std::mutex               m_callbackMutex;
+	std::atomic<std::size_t> m_count{0};
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* InputFile_
+Read-only file handle with positional reads, used by AsyncReader. A size of
+zero means either an empty file or one whose size is not known in advance
+(e.g. pipes, virtual files). */
+
+class InputFile_
+{
+public:
+	explicit InputFile_(const std::string& path)
+	{
+#if MCL_OS_WINDOWS
+		m_stream.open(stdfs::path(path), std::ios::binary);
+		if (!m_stream)
+		{
+			m_error = std::make_error_code(std::errc::no_such_file_or_directory);
+			return;
+		}
+		std::error_code ec;
+		if (stdfs::is_regular_file(path, ec))
+			m_size = static_cast<std::size_t>(stdfs::file_size(path, ec));
+#else
+		m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_fd == -1)
+		{
+			m_error = {errno, std::generic_category()};
+			return;
+		}
+		struct stat st;
+		if (::fstat(m_fd, &st) != 0)
+		{
+			m_error = {errno, std::generic_category()};
+			return;
+		}
+		if (S_ISREG(st.st_mode))
+			m_size = static_cast<std::size_t>(st.st_size);
+#if MCL_OS_LINUX || MCL_OS_FREEBSD
+		::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+	}
+
+	InputFile_(const InputFile_&)            = delete;
+	InputFile_& operator=(const InputFile_&) = delete;
+
+	~InputFile_()
+	{
+		close();
+	}
+
+	bool            isOpen() const { return !m_error; }
+	std::error_code getError() const { return m_error; }
+	std::size_t     getSize() const { return m_size; }
+#if !MCL_OS_WINDOWS
+	int getFd() const { return m_fd; }
+#endif
+
+	/* readAt
+	Reads up to 'size' bytes at 'offset'. Returns the number of bytes read, 0 on
+	end of file or error. */
+
+	std::size_t readAt(std::byte* data, std::size_t size, std::size_t offset, std::error_code& ec)
+	{
+#if MCL_OS_WINDOWS
+		m_stream.clear();
+		m_stream.seekg(static_cast<std::streamoff>(offset));
+		m_stream.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size));
+		if (m_stream.bad())
+			ec = std::make_error_code(std::errc::io_error);
+		return static_cast<std::size_t>(m_stream.gcount());
+#else
+		while (true)
+		{
+			const ssize_t res = ::pread(m_fd, data, size, static_cast<off_t>(offset));
+			if (res >= 0)
+				return static_cast<std::size_t>(res);
+			if (errno != EINTR)
+			{
+				ec = {errno, std::generic_category()};
+				return 0;
+			}
+		}
+#endif
+	}
+
+	/* readFully
+	Like readAt, but keeps reading until 'size' bytes are in or the file ends. */
+
+	std::size_t readFully(std::byte* data, std::size_t size, std::size_t offset, std::error_code& ec)
+	{
+		std::size_t done = 0;
+		while (done < size)
+		{
+			const std::size_t res = readAt(data + done, size - done, offset + done, ec);
+			if (res == 0)
+				break;
+			done += res;
+		}
+		return done;
+	}
+
+	void close()
+	{
+#if MCL_OS_WINDOWS
+		m_stream.close();
+#else
+		if (m_fd != -1)
+			::close(m_fd);
+		m_fd = -1;
+#endif
+	}
+
+private:
+#if MCL_OS_WINDOWS
+	std::ifstream m_stream;
+#else
+	int m_fd = -1;
+#endif
+	std::size_t     m_size = 0;
+	std::error_code m_error;
+};
+
+/* -------------------------------------------------------------------------- */
+
+#if MCL_OS_LINUX
+
+/* Ring_
+Bare io_uring instance driven through raw system calls, so that no liburing
+is needed. Only used from a single thread. */
+
+class Ring_
+{
+public:
+	Ring_() = default;
+	Ring_(const Ring_&)            = delete;
+	Ring_& operator=(const Ring_&) = delete;
+
+	~Ring_()
+	{
+		if (m_sqes != nullptr)
+			::munmap(m_sqes, m_sqesSize);
+		if (m_cqRing != nullptr && m_cqRing != m_sqRing)
+			::munmap(m_cqRing, m_cqRingSize);
+		if (m_sqRing != nullptr)
+			::munmap(m_sqRing, m_sqRingSize);
+		if (m_fd != -1)
+			::close(m_fd);
+	}
+
+	/* init
+	Returns false if io_uring is not available, e.g. on old kernels or when
+	blocked by a seccomp filter. */
+
+	bool init(unsigned entries)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+
+		const long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+		if (fd < 0)
+			return false;
+		m_fd = static_cast<int>(fd);
+
+		m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		m_sqesSize   = params.sq_entries * sizeof(io_uring_sqe);
+
+		bool singleMmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+		singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (singleMmap)
+			m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+#endif
+
+		m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+		m_cqRing = singleMmap ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+		m_sqes   = static_cast<io_uring_sqe*>(map(m_sqesSize, IORING_OFF_SQES));
+		if (m_sqRing == nullptr || m_cqRing == nullptr || m_sqes == nullptr)
+			return false;
+
+		char* sq  = static_cast<char*>(m_sqRing);
+		char* cq  = static_cast<char*>(m_cqRing);
+		m_sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		m_sqMask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		m_cqHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		m_cqTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		m_cqMask  = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		m_cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		return true;
+	}
+
+	/* pushRead
+	Queues a vectored read. The caller must never have more reads in flight
+	than the number of entries the ring was created with. */
+
+	void pushRead(int fd, const iovec* iov, std::size_t offset, void* userData)
+	{
+		const unsigned tail  = *m_sqTail; // Only written by us
+		const unsigned index = tail & m_sqMask;
+
+		io_uring_sqe& sqe = m_sqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode    = IORING_OP_READV;
+		sqe.fd        = fd;
+		sqe.addr      = reinterpret_cast<std::uint64_t>(iov);
+		sqe.len       = 1;
+		sqe.off       = offset;
+		sqe.user_data = reinterpret_cast<std::uint64_t>(userData);
+
+		m_sqArray[index] = index;
+		std::atomic_ref<unsigned>(*m_sqTail).store(tail + 1, std::memory_order_release);
+		m_toSubmit++;
+	}
+
+	/* submitAndWait
+	Submits all queued reads and waits for at least one completion. */
+
+	bool submitAndWait()
+	{
+		while (true)
+		{
+			const long res = ::syscall(__NR_io_uring_enter, m_fd, m_toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (res >= 0)
+			{
+				m_toSubmit -= std::min(static_cast<unsigned>(res), m_toSubmit);
+				return true;
+			}
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				return false;
+		}
+	}
+
+	/* retract
+	Takes back the reads queued since the last submission, which the kernel
+	hasn't seen yet. Returns how many. */
+
+	unsigned retract()
+	{
+		const unsigned count = std::exchange(m_toSubmit, 0);
+		std::atomic_ref<unsigned>(*m_sqTail).store(*m_sqTail - count, std::memory_order_release);
+		return count;
+	}
+
+	/* pollCompletion
+	Waits for a completion without entering the ring, for when
+	io_uring_enter() itself fails. Completions are still posted by the kernel
+	(the sleep gives it a chance to run pending work for this thread). */
+
+	void pollCompletion() const
+	{
+		while (std::atomic_ref<unsigned>(*m_cqTail).load(std::memory_order_acquire) == *m_cqHead)
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	/* reap
+	Calls f(userData, result) for each available completion. */
+
+	template <typename F>
+	void reap(F&& f)
+	{
+		unsigned       head = *m_cqHead; // Only written by us
+		const unsigned tail = std::atomic_ref<unsigned>(*m_cqTail).load(std::memory_order_acquire);
+		for (; head != tail; head++)
+		{
+			const io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+			f(reinterpret_cast<void*>(cqe.user_data), cqe.res);
+		}
+		std::atomic_ref<unsigned>(*m_cqHead).store(head, std::memory_order_release);
+	}
+
+private:
+	void* map(std::size_t size, off_t offset) const
+	{
+		void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+		return p == MAP_FAILED ? nullptr : p;
+	}
+
+	int           m_fd         = -1;
+	void*         m_sqRing     = nullptr;
+	void*         m_cqRing     = nullptr;
+	io_uring_sqe* m_sqes       = nullptr;
+	std::size_t   m_sqRingSize = 0;
+	std::size_t   m_cqRingSize = 0;
+	std::size_t   m_sqesSize   = 0;
+	unsigned*     m_sqTail     = nullptr;
+	unsigned*     m_sqArray    = nullptr;
+	unsigned      m_sqMask     = 0;
+	unsigned*     m_cqHead     = nullptr;
+	unsigned*     m_cqTail     = nullptr;
+	unsigned      m_cqMask     = 0;
+	io_uring_cqe* m_cqes       = nullptr;
+	unsigned      m_toSubmit   = 0;
+};
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+constexpr std::size_t WRITER_ALIGNMENT = 4096; // Page size, for AtomicWriter buffers
+
+std::atomic<unsigned> writerSerial_{0};
+
+/* makeTempPath_
+Returns a hidden sibling of 'path', unique to this process and 'serial'. */
+
+std::string makeTempPath_(std::string_view path, unsigned serial)
+{
+#if MCL_OS_WINDOWS
+	const unsigned long pid = GetCurrentProcessId();
+#else
+	const long pid = static_cast<long>(::getpid());
+#endif
+	const std::string_view name = basenameView(path);
+	std::string            out(path.substr(0, path.size() - name.size()));
+	out += ".";
+	out += name;
+	out += ".tmp-" + std::to_string(pid) + "-" + std::to_string(serial);
+	return out;
+}
 } // namespace
 
 /* -------------------------------------------------------------------------- */
@@ -222,10 +854,8 @@ std::string getUpDir(const std::string& s)
 
 std::string uriToPath(const std::string& uri)
 {
-	std::string out = uri;
-	out             = string::replace(out, "file://", "");
-	out             = string::replace(out, "%20", " ");
-	return out;
+	static const string::Replacer replacer({{"file://", ""}, {"%20", " "}});
+	return replacer.apply(uri);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -250,4 +880,1406 @@ bool isValidFileName(const std::string& f)
 			return false;
 	return true;
 }
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t scan(const std::string& root, const ScanOptions& options, const ScanCallback& callback)
+{
+	return Scanner_(options, callback).run(root);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view basenameView(std::string_view s)
+{
+	const std::size_t sep = findLastSeparator_(s);
+	const std::size_t pos = sep == std::string_view::npos ? 0 : sep + 1;
+#if MCL_OS_WINDOWS
+	if (pos == 0 && s.size() >= 2 && s[1] == ':')
+		return s.substr(2);
+#endif
+	return s.substr(pos);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view dirnameView(std::string_view s)
+{
+	const std::size_t root = getRootLength_(s);
+	const std::size_t all  = std::find_if_not(s.begin() + root, s.end(), isSeparator_) - s.begin();
+	if (all == s.size()) // Root only (or empty)
+		return s;
+
+	/* Drop the file name, if any, then trailing separators. Stop at the
+	root. */
+
+	std::size_t end = s.size() - basenameView(s).size();
+	while (end > root && isSeparator_(s[end - 1]))
+		end--;
+	return s.substr(0, end);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view getExtView(std::string_view s)
+{
+	const std::string_view name = basenameView(s);
+	if (name == "." || name == "..")
+		return {};
+	const std::size_t dot = name.rfind('.');
+	return dot == std::string_view::npos || dot == 0 ? std::string_view{} : name.substr(dot);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view getStemView(std::string_view s)
+{
+	const std::string_view name = basenameView(s);
+	return name.substr(0, name.size() - getExtView(name).size());
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view stripExtView(std::string_view s)
+{
+	return s.substr(0, s.size() - getExtView(s).size());
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string_view join(std::string_view a, std::string_view b, std::span<char> buffer)
+{
+	if (a.empty() || getRootLength_(b) > 0) // 'b' is absolute
+		a = {};
+
+#if MCL_OS_WINDOWS
+	const bool needsSeparator = !a.empty() && !isSeparator_(a.back()) && a.back() != ':'; // 'C:' + 'b' = 'C:b'
+#else
+	const bool needsSeparator = !a.empty() && !isSeparator_(a.back());
+#endif
+	const std::size_t size = a.size() + (needsSeparator ? 1 : 0) + b.size();
+	if (size > buffer.size())
+		return {};
+
+	char* out = std::copy(a.begin(), a.end(), buffer.data());
+	if (needsSeparator)
+		*out++ = static_cast<char>(stdfs::path::preferred_separator);
+	std::copy(b.begin(), b.end(), out);
+	return {buffer.data(), size};
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+#if MCL_OS_LINUX || MCL_OS_FREEBSD || MCL_OS_MAC
+
+MappedFile::MappedFile(const std::string& path, Hint hint, [[maybe_unused]] bool hugePages)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		::close(fd);
+		readBuffered(path);
+		return;
+	}
+
+	void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // The mapping keeps its own reference to the file
+	if (data == MAP_FAILED)
+	{
+		readBuffered(path);
+		return;
+	}
+
+	m_data   = static_cast<const std::byte*>(data);
+	m_size   = static_cast<std::size_t>(st.st_size);
+	m_open   = true;
+	m_mapped = true;
+
+#if MCL_OS_LINUX && defined(MADV_HUGEPAGE)
+	if (hugePages)
+		::madvise(data, m_size, MADV_HUGEPAGE);
+#endif
+	advise(hint);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MappedFile::advise(Hint hint)
+{
+	if (!m_mapped)
+		return;
+
+	int advice = POSIX_MADV_NORMAL;
+	switch (hint)
+	{
+	case Hint::SEQUENTIAL:
+		advice = POSIX_MADV_SEQUENTIAL;
+		break;
+	case Hint::RANDOM:
+		advice = POSIX_MADV_RANDOM;
+		break;
+	case Hint::WILLNEED:
+		advice = POSIX_MADV_WILLNEED;
+		break;
+	default:
+		break;
+	}
+	::posix_madvise(const_cast<std::byte*>(m_data), m_size, advice);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MappedFile::close() noexcept
+{
+	if (m_mapped)
+		::munmap(const_cast<std::byte*>(m_data), m_size);
+	m_buffer.clear();
+	m_data   = nullptr;
+	m_size   = 0;
+	m_open   = false;
+	m_mapped = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MappedFile::readBuffered(const std::string& path)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+
+	constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+	std::size_t size = 0;
+	while (true)
+	{
+		m_buffer.resize(size + CHUNK_SIZE);
+		const ssize_t n = ::read(fd, m_buffer.data() + size, CHUNK_SIZE);
+		if (n < 0)
+		{
+			::close(fd);
+			m_buffer.clear();
+			return false;
+		}
+		if (n == 0)
+			break;
+		size += static_cast<std::size_t>(n);
+	}
+	::close(fd);
+
+	m_buffer.resize(size);
+	m_data = m_buffer.data();
+	m_size = size;
+	m_open = true;
+	return true;
+}
+
+#elif MCL_OS_WINDOWS
+
+MappedFile::MappedFile(const std::string& path, Hint hint, bool /*hugePages*/)
+{
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (hint == Hint::SEQUENTIAL)
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	else if (hint == Hint::RANDOM)
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+
+	const HANDLE file = CreateFileW(stdfs::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		readBuffered(path);
+		return;
+	}
+
+	const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void*  data    = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (mapping != nullptr)
+		CloseHandle(mapping); // The view keeps the mapping alive
+	CloseHandle(file);
+	if (data == nullptr)
+	{
+		readBuffered(path);
+		return;
+	}
+
+	m_data   = static_cast<const std::byte*>(data);
+	m_size   = static_cast<std::size_t>(size.QuadPart);
+	m_open   = true;
+	m_mapped = true;
+
+	advise(hint);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MappedFile::advise(Hint hint)
+{
+	if (!m_mapped || hint != Hint::WILLNEED)
+		return;
+	WIN32_MEMORY_RANGE_ENTRY range{const_cast<std::byte*>(m_data), m_size};
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MappedFile::close() noexcept
+{
+	if (m_mapped)
+		UnmapViewOfFile(m_data);
+	m_buffer.clear();
+	m_data   = nullptr;
+	m_size   = 0;
+	m_open   = false;
+	m_mapped = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MappedFile::readBuffered(const std::string& path)
+{
+	std::ifstream file(stdfs::path(path), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	m_buffer.resize(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size()))
+	{
+		m_buffer.clear();
+		return false;
+	}
+	m_data = m_buffer.data();
+	m_size = m_buffer.size();
+	m_open = true;
+	return true;
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+{
+	*this = std::move(o);
+}
+
+/* -------------------------------------------------------------------------- */
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept
+{
+	if (this == &o)
+		return *this;
+	close();
+	m_buffer = std::move(o.m_buffer);
+	m_data   = o.m_mapped ? o.m_data : m_buffer.data();
+	m_size   = o.m_size;
+	m_open   = o.m_open;
+	m_mapped = o.m_mapped;
+
+	o.m_data   = nullptr;
+	o.m_size   = 0;
+	o.m_open   = false;
+	o.m_mapped = false;
+	return *this;
+}
+
+/* -------------------------------------------------------------------------- */
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+/* MetadataCache::Impl
+Entries live in an ordered map guarded by a mutex. On Linux a background
+thread waits for inotify events and drops the affected entries; it's woken up
+through an eventfd on shutdown. 'generation' is bumped on every invalidation,
+so that a query racing with an event doesn't store a result that's already
+stale. */
+
+struct MetadataCache::Impl
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry
+	{
+		bool                       exists;
+		bool                       isDir;
+		std::optional<std::string> realPath;
+		Clock::time_point          expires;
+	};
+
+	explicit Impl(std::chrono::milliseconds t)
+	: ttl(t)
+	{
+#if MCL_OS_LINUX
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		wakeupFd  = eventfd(0, EFD_CLOEXEC);
+		if (inotifyFd != -1 && wakeupFd != -1)
+			thread = std::thread([this]() { run(); });
+#endif
+	}
+
+	~Impl()
+	{
+#if MCL_OS_LINUX
+		if (thread.joinable())
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const ssize_t res = ::write(wakeupFd, &one, sizeof(one));
+			thread.join();
+		}
+		if (inotifyFd != -1)
+			::close(inotifyFd);
+		if (wakeupFd != -1)
+			::close(wakeupFd);
+#endif
+	}
+
+	/* get
+	Returns the entry for 'path', filling it on a miss. 'withRealPath' also
+	makes sure the canonical path is available. Returns a copy, so that the lock
+	isn't held by the caller. */
+
+	Entry get(const std::string& path, bool withRealPath)
+	{
+		std::size_t currentGeneration;
+		{
+			std::scoped_lock lock(mutex);
+			const auto       it = entries.find(path);
+			if (it != entries.end() && it->second.expires > Clock::now() && (!withRealPath || it->second.realPath))
+			{
+				hits++;
+				return it->second;
+			}
+			currentGeneration = generation;
+		}
+
+		misses++;
+
+		std::error_code          ec;
+		const stdfs::file_status status = stdfs::status(path, ec);
+
+		Entry entry;
+		entry.exists = stdfs::exists(status);
+		entry.isDir  = stdfs::is_directory(status);
+		if (withRealPath)
+		{
+			entry.realPath = "";
+			if (!path.empty() && entry.exists)
+			{
+				const stdfs::path canonical = stdfs::canonical(path, ec);
+				if (!ec)
+					entry.realPath = canonical.string();
+			}
+		}
+
+		std::scoped_lock lock(mutex);
+		if (generation != currentGeneration)
+			return entry; // Something changed in the meantime: don't cache
+		entry.expires = isWatched(path) ? Clock::time_point::max() : Clock::now() + ttl;
+		entries[path] = entry;
+		return entry;
+	}
+
+	bool isWatched(const std::string& path) const
+	{
+		return watchedDirs.contains(path) || watchedDirs.contains(std::string(dirnameView(path)));
+	}
+
+	/* invalidate
+	Drops 'path' and all entries below it. Keys starting with 'path' are sorted
+	right after it, so only that range is visited; it also contains siblings
+	sharing the prefix (e.g. "dir2" for "dir"), which are skipped. Must be
+	called with the lock held. */
+
+	void invalidate(const std::string& path)
+	{
+		generation++;
+		for (auto it = entries.lower_bound(path); it != entries.end() && it->first.starts_with(path);)
+		{
+			const std::string& key = it->first;
+			if (key.size() == path.size() || isSeparator_(key[path.size()]) || (!path.empty() && isSeparator_(path.back())))
+			{
+				it = entries.erase(it);
+				invalidations++;
+			}
+			else
+				++it;
+		}
+	}
+
+	void clear()
+	{
+		generation++;
+		invalidations += entries.size();
+		entries.clear();
+	}
+
+#if MCL_OS_LINUX
+
+	bool watch(std::string dir)
+	{
+		if (!thread.joinable())
+			return false;
+		while (dir.size() > 1 && isSeparator_(dir.back()))
+			dir.pop_back();
+
+		const std::uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+		const int           wd   = inotify_add_watch(inotifyFd, dir.c_str(), mask);
+		if (wd == -1)
+			return false;
+
+		std::scoped_lock lock(mutex);
+		invalidate(dir); // Existing entries were cached with a TTL
+		watches[wd] = dir;
+		watchedDirs.insert(dir);
+		return true;
+	}
+
+	void run()
+	{
+		pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeupFd, POLLIN, 0}};
+		while (true)
+		{
+			if (::poll(fds, 2, -1) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return;
+			}
+			if (fds[1].revents != 0)
+				return;
+
+			alignas(inotify_event) char buffer[4096];
+			const ssize_t               size = ::read(inotifyFd, buffer, sizeof(buffer));
+			if (size <= 0)
+				continue;
+
+			std::scoped_lock lock(mutex);
+			for (const char* p = buffer; p < buffer + size;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+				p += sizeof(inotify_event) + event->len;
+				process(*event);
+			}
+		}
+	}
+
+	/* process
+	Handles a single inotify event. Must be called with the lock held. */
+
+	void process(const inotify_event& event)
+	{
+		if (event.mask & IN_Q_OVERFLOW) // Events lost: nothing can be trusted
+		{
+			clear();
+			return;
+		}
+
+		const auto it = watches.find(event.wd);
+		if (it == watches.end())
+			return;
+		const std::string dir = it->second;
+
+		if (event.mask & IN_IGNORED) // Watch removed, by us or by the kernel
+		{
+			invalidate(dir);
+			watchedDirs.erase(dir);
+			watches.erase(it);
+		}
+		else if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+		{
+			invalidate(dir);
+			inotify_rm_watch(inotifyFd, event.wd); // Path no longer valid: fall back to TTL
+		}
+		else if (event.len > 0)
+			invalidate(dir + '/' + event.name);
+	}
+
+	int                                  inotifyFd = -1;
+	int                                  wakeupFd  = -1;
+	std::thread                          thread;
+	std::unordered_map<int, std::string> watches; // Watch descriptor -> directory
+
+#else
+
+	bool watch(const std::string&)
+	{
+		return false;
+	}
+
+#endif
+
+	const std::chrono::milliseconds ttl;
+
+	std::mutex                             mutex; // Guards everything below
+	std::map<std::string, Entry>    entries; // Ordered, for prefix invalidation
+	std::unordered_set<std::string> watchedDirs;
+	std::size_t                     generation = 0;
+
+	std::atomic<std::size_t> hits{0};
+	std::atomic<std::size_t> misses{0};
+	std::atomic<std::size_t> invalidations{0};
+};
+
+/* -------------------------------------------------------------------------- */
+
+MetadataCache::MetadataCache(std::chrono::milliseconds ttl)
+: m_impl(std::make_unique<Impl>(ttl))
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+MetadataCache::~MetadataCache() = default;
+
+/* -------------------------------------------------------------------------- */
+
+bool MetadataCache::fileExists(const std::string& s)
+{
+	return m_impl->get(s, /*withRealPath=*/false).exists;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MetadataCache::dirExists(const std::string& s)
+{
+	return m_impl->get(s, /*withRealPath=*/false).exists; // Same as fs::dirExists
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MetadataCache::isDir(const std::string& s)
+{
+	return m_impl->get(s, /*withRealPath=*/false).isDir;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string MetadataCache::getRealPath(const std::string& s)
+{
+	return *m_impl->get(s, /*withRealPath=*/true).realPath;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MetadataCache::watch(const std::string& dir)
+{
+	return m_impl->watch(dir);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MetadataCache::invalidate(const std::string& path)
+{
+	std::scoped_lock lock(m_impl->mutex);
+	m_impl->invalidate(path);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MetadataCache::clear()
+{
+	std::scoped_lock lock(m_impl->mutex);
+	m_impl->clear();
+}
+
+/* -------------------------------------------------------------------------- */
+
+MetadataCache::Stats MetadataCache::getStats() const
+{
+	return {m_impl->hits.load(), m_impl->misses.load(), m_impl->invalidations.load()};
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+/* AsyncReader::Impl
+Requests are queued and served either by a single thread driving an io_uring
+instance, or by a pool of worker threads doing blocking reads. Either way each
+request becomes an Op: anything that doesn't need positional reads (errors,
+empty or virtual files) is completed right away by start(), the rest gets a
+buffer and is read in full before finish() hands it to the callback. */
+
+struct AsyncReader::Impl
+{
+	struct Request
+	{
+		std::string          path;
+		std::span<std::byte> buffer;
+		bool                 pooled;
+		Callback             callback;
+	};
+
+	struct Op
+	{
+		explicit Op(Request&& r)
+		: request(std::move(r))
+		, file(request.path)
+		{
+		}
+
+		Request     request;
+		InputFile_  file;
+		Result      result;
+		std::byte*  data   = nullptr;
+		std::size_t size   = 0;
+		std::size_t done   = 0;
+		std::size_t budget = 0;
+#if MCL_OS_LINUX
+		iovec iov;
+#endif
+	};
+
+	explicit Impl(const AsyncReaderOptions& o)
+	: options(o)
+	{
+#if MCL_OS_LINUX
+		if (options.preferIoUring && ring.init(static_cast<unsigned>(std::clamp<std::size_t>(options.queueDepth, 1, 4096))))
+		{
+			backend = Backend::IO_URING;
+			threads.emplace_back([this]() { runRing(); });
+			return;
+		}
+#endif
+		for (std::size_t i = 0; i < std::max<std::size_t>(options.threads, 1); i++)
+			threads.emplace_back([this]() { runWorker(); });
+	}
+
+	~Impl()
+	{
+		wait();
+		{
+			std::scoped_lock lock(mutex);
+			stopping = true;
+		}
+		cond.notify_all();
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	void submit(Request&& request)
+	{
+		{
+			std::scoped_lock lock(mutex);
+			requests.push_back(std::move(request));
+			outstanding++;
+		}
+		cond.notify_one();
+	}
+
+	void wait()
+	{
+		std::unique_lock lock(mutex);
+		doneCond.wait(lock, [this]() { return outstanding == 0; });
+	}
+
+	/* start
+	Returns false if the Op is already complete and needs no more reads. */
+
+	bool start(Op& op)
+	{
+		op.result.path = op.request.path;
+		if (!op.file.isOpen())
+		{
+			op.result.error = op.file.getError();
+			return false;
+		}
+
+		op.size = op.file.getSize();
+		if (op.size == 0)
+		{
+			readStream(op);
+			return false;
+		}
+		if (!op.request.pooled)
+		{
+			if (op.size > op.request.buffer.size())
+			{
+				op.result.error = std::make_error_code(std::errc::value_too_large);
+				return false;
+			}
+			op.data = op.request.buffer.data();
+		}
+		return true;
+	}
+
+	/* readStream
+	Reads files of unknown size in chunks. Their memory is not accounted. */
+
+	void readStream(Op& op)
+	{
+		constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+		if (!op.request.pooled)
+		{
+			op.data = op.request.buffer.data();
+			op.done = op.file.readFully(op.data, op.request.buffer.size(), 0, op.result.error);
+
+			std::byte probe;
+			if (!op.result.error && op.done == op.request.buffer.size() && op.file.readAt(&probe, 1, op.done, op.result.error) > 0)
+				op.result.error = std::make_error_code(std::errc::value_too_large);
+			return;
+		}
+
+		std::vector<std::byte>& buffer = op.result.buffer;
+		while (!op.result.error)
+		{
+			const std::size_t offset = buffer.size();
+			buffer.resize(offset + CHUNK_SIZE);
+			const std::size_t res = op.file.readAt(buffer.data() + offset, CHUNK_SIZE, offset, op.result.error);
+			buffer.resize(offset + res);
+			if (res == 0)
+				break;
+		}
+		op.done = buffer.size();
+	}
+
+	/* tryAcquire
+	Reserves 'size' bytes of in-flight memory. A single read is always allowed,
+	whatever its size. Must be called with the lock held. */
+
+	bool tryAcquire(std::size_t size)
+	{
+		if (inFlightBytes != 0 && inFlightBytes + size > options.maxInFlightBytes)
+			return false;
+		inFlightBytes += size;
+		return true;
+	}
+
+	/* takeBuffer
+	Returns a pooled buffer with enough capacity, or a new one. Must be called
+	with the lock held. */
+
+	std::vector<std::byte> takeBuffer(std::size_t size)
+	{
+		for (auto it = pool.begin(); it != pool.end(); ++it)
+		{
+			if (it->capacity() < size)
+				continue;
+			std::vector<std::byte> buffer = std::move(*it);
+			pooledBytes -= buffer.capacity();
+			pool.erase(it);
+			return buffer;
+		}
+		return {};
+	}
+
+	/* allocate
+	Sets up the pooled buffer of an Op, whose memory has already been reserved. */
+
+	void allocate(Op& op, std::unique_lock<std::mutex>& lock)
+	{
+		op.budget        = op.size;
+		op.result.buffer = takeBuffer(op.size);
+		lock.unlock();
+		op.result.buffer.resize(op.size);
+		op.data = op.result.buffer.data();
+	}
+
+	void finish(Op& op)
+	{
+		op.file.close();
+		if (op.request.pooled)
+		{
+			op.result.buffer.resize(op.done);
+			op.result.data = op.result.buffer;
+		}
+		else
+			op.result.data = {op.data, op.done};
+
+		op.request.callback(op.result);
+		op.request.callback = nullptr; // Release captures before wait() can return
+
+		{
+			std::scoped_lock        lock(mutex);
+			std::vector<std::byte>& buffer = op.result.buffer;
+			if (buffer.capacity() > 0 && pooledBytes + buffer.capacity() <= options.maxInFlightBytes)
+			{
+				buffer.clear();
+				pooledBytes += buffer.capacity();
+				pool.push_back(std::move(buffer));
+			}
+			inFlightBytes -= op.budget;
+			outstanding--;
+		}
+		budgetCond.notify_all();
+		doneCond.notify_all();
+	}
+
+	/* popRequest
+	Returns false when stopping. Must be called with the lock held. */
+
+	bool popRequest(std::unique_lock<std::mutex>& lock, Request& request)
+	{
+		cond.wait(lock, [this]() { return stopping || !requests.empty(); });
+		if (requests.empty())
+			return false;
+		request = std::move(requests.front());
+		requests.pop_front();
+		return true;
+	}
+
+	void runWorker()
+	{
+		while (true)
+		{
+			Request request;
+			{
+				std::unique_lock lock(mutex);
+				if (!popRequest(lock, request))
+					return;
+			}
+
+			Op op(std::move(request));
+			if (start(op))
+			{
+				if (op.request.pooled)
+				{
+					std::unique_lock lock(mutex);
+					budgetCond.wait(lock, [this, &op]() { return tryAcquire(op.size); });
+					allocate(op, lock);
+				}
+				op.done = op.file.readFully(op.data, op.size, 0, op.result.error);
+			}
+			finish(op);
+		}
+	}
+
+#if MCL_OS_LINUX
+
+	/* runRing
+	Keeps up to 'queueDepth' reads in the ring. A pooled request that doesn't
+	fit in the memory budget is parked until some completions free enough. Short
+	reads are resubmitted for the remaining part. */
+
+	void runRing()
+	{
+		const std::size_t                depth = std::clamp<std::size_t>(options.queueDepth, 1, 4096);
+		std::vector<std::unique_ptr<Op>> active;
+		std::unique_ptr<Op>              parked;
+
+		while (true)
+		{
+			while (active.size() < depth)
+			{
+				std::unique_ptr<Op> op = std::move(parked);
+				if (op == nullptr)
+				{
+					Request request;
+					{
+						std::unique_lock lock(mutex);
+						if (requests.empty())
+							break;
+						request = std::move(requests.front());
+						requests.pop_front();
+					}
+					op = std::make_unique<Op>(std::move(request));
+					if (!start(*op))
+					{
+						finish(*op);
+						continue;
+					}
+				}
+				if (op->request.pooled)
+				{
+					std::unique_lock lock(mutex);
+					if (!tryAcquire(op->size))
+					{
+						parked = std::move(op);
+						break;
+					}
+					allocate(*op, lock);
+				}
+				submitRead(*op);
+				active.push_back(std::move(op));
+			}
+
+			if (active.empty())
+			{
+				std::unique_lock lock(mutex);
+				cond.wait(lock, [this]() { return stopping || !requests.empty(); });
+				if (requests.empty())
+					return;
+				continue;
+			}
+
+			if (!ring.submitAndWait())
+			{
+				abandonRing(active, std::move(parked));
+				runWorker();
+				return;
+			}
+
+			ring.reap([this, &active](void* userData, int res) {
+				Op& op = *static_cast<Op*>(userData);
+				if (res == -EINTR || res == -EAGAIN)
+				{
+					submitRead(op);
+					return;
+				}
+				if (res < 0)
+					op.result.error = {-res, std::generic_category()};
+				else
+					op.done += static_cast<std::size_t>(res);
+
+				if (res > 0 && op.done < op.size)
+				{
+					submitRead(op);
+					return;
+				}
+				finish(op);
+				std::erase_if(active, [&op](const std::unique_ptr<Op>& p) { return p.get() == &op; });
+			});
+		}
+	}
+
+	/* abandonRing
+	Called when the ring becomes unusable. Each active op has exactly one read
+	either still queued or in the kernel: queued ones are taken back, the others
+	must complete before their buffers can be touched. Then everything is
+	finished synchronously, and this thread carries on as a plain worker. */
+
+	void abandonRing(std::vector<std::unique_ptr<Op>>& active, std::unique_ptr<Op> parked)
+	{
+		for (std::size_t inKernel = active.size() - ring.retract(); inKernel > 0;)
+		{
+			ring.pollCompletion();
+			ring.reap([&inKernel](void* userData, int res) {
+				if (res > 0)
+					static_cast<Op*>(userData)->done += static_cast<std::size_t>(res);
+				inKernel--;
+			});
+		}
+
+		for (std::unique_ptr<Op>& op : active)
+		{
+			op->done += op->file.readFully(op->data + op->done, op->size - op->done, op->done, op->result.error);
+			finish(*op);
+		}
+		active.clear();
+
+		if (parked != nullptr) // Opened, but still waiting for its budget
+		{
+			{
+				std::unique_lock lock(mutex);
+				budgetCond.wait(lock, [this, &parked]() { return tryAcquire(parked->size); });
+				allocate(*parked, lock);
+			}
+			parked->done = parked->file.readFully(parked->data, parked->size, 0, parked->result.error);
+			finish(*parked);
+		}
+	}
+
+	void submitRead(Op& op)
+	{
+		op.iov = {op.data + op.done, op.size - op.done};
+		ring.pushRead(op.file.getFd(), &op.iov, op.done, &op);
+	}
+
+	Ring_ ring;
+
+#endif
+
+	const AsyncReaderOptions options;
+	Backend                  backend = Backend::THREADS;
+	std::vector<std::thread> threads;
+
+	std::mutex                          mutex; // Guards everything below
+	std::condition_variable             cond;
+	std::condition_variable             budgetCond;
+	std::condition_variable             doneCond;
+	std::deque<Request>                 requests;
+	std::vector<std::vector<std::byte>> pool;
+	std::size_t                         pooledBytes   = 0;
+	std::size_t                         inFlightBytes = 0;
+	std::size_t                         outstanding   = 0;
+	bool                                stopping      = false;
+};
+
+/* -------------------------------------------------------------------------- */
+
+AsyncReader::AsyncReader(const AsyncReaderOptions& options)
+: m_impl(std::make_unique<Impl>(options))
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+AsyncReader::~AsyncReader() = default;
+
+/* -------------------------------------------------------------------------- */
+
+AsyncReader::Backend AsyncReader::getBackend() const
+{
+	return m_impl->backend;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AsyncReader::read(std::span<const std::string> paths, Callback callback)
+{
+	for (const std::string& path : paths)
+		m_impl->submit({path, {}, /*pooled=*/true, callback});
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AsyncReader::read(const std::string& path, std::span<std::byte> buffer, Callback callback)
+{
+	m_impl->submit({path, buffer, /*pooled=*/false, std::move(callback)});
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::future<AsyncReader::Result> AsyncReader::read(const std::string& path)
+{
+	auto                promise = std::make_shared<std::promise<Result>>();
+	std::future<Result> future  = promise->get_future();
+	m_impl->submit({path, {}, /*pooled=*/true, [promise = std::move(promise)](Result& result) { promise->set_value(std::move(result)); }});
+	return future;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AsyncReader::wait()
+{
+	m_impl->wait();
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void AtomicWriter::BufferDeleter::operator()(std::byte* p) const noexcept
+{
+	::operator delete[](p, std::align_val_t{WRITER_ALIGNMENT});
+}
+
+/* -------------------------------------------------------------------------- */
+
+AtomicWriter::~AtomicWriter()
+{
+	discard();
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::error_code AtomicWriter::getError() const
+{
+	return m_error;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::write(std::string_view s)
+{
+	return write(std::as_bytes(std::span(s)));
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::write(std::span<const std::byte> data)
+{
+	if (!isOpen() || m_error)
+		return false;
+
+	/* Large chunks skip the buffer altogether, if nothing is pending. */
+
+	if (m_used == 0 && data.size() >= m_bufferSize)
+		return writeToFile(data.data(), data.size());
+
+	while (!data.empty())
+	{
+		const std::size_t size = std::min(data.size(), m_bufferSize - m_used);
+		std::memcpy(m_buffer.get() + m_used, data.data(), size);
+		m_used += size;
+		data = data.subspan(size);
+		if (m_used == m_bufferSize && !flush())
+			return false;
+	}
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::flush()
+{
+	const std::size_t used = m_used;
+	m_used                 = 0;
+	return writeToFile(m_buffer.get(), used);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AtomicWriter::setError(std::error_code ec)
+{
+	if (!m_error)
+		m_error = ec;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#if MCL_OS_LINUX || MCL_OS_FREEBSD || MCL_OS_MAC
+
+AtomicWriter::AtomicWriter(const std::string& path, const AtomicWriterOptions& options)
+: m_path(path)
+, m_bufferSize((std::max<std::size_t>(options.bufferSize, 1) + WRITER_ALIGNMENT - 1) / WRITER_ALIGNMENT * WRITER_ALIGNMENT)
+, m_durable(options.durable)
+{
+	m_buffer.reset(static_cast<std::byte*>(::operator new[](m_bufferSize, std::align_val_t{WRITER_ALIGNMENT})));
+
+	for (int attempt = 0; attempt < 16 && m_file == -1; attempt++)
+	{
+		m_tempPath = makeTempPath_(path, writerSerial_++);
+		m_file     = ::open(m_tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (m_file == -1 && errno != EEXIST)
+			break;
+	}
+	if (m_file == -1)
+	{
+		setError({errno, std::generic_category()});
+		m_tempPath.clear();
+		return;
+	}
+
+	/* Keep the permissions of the file being replaced, if any. */
+
+	struct stat st;
+	if (::stat(path.c_str(), &st) == 0)
+		::fchmod(m_file, st.st_mode & 07777);
+
+	if (options.preallocate == 0)
+		return;
+#if MCL_OS_LINUX
+	const int res = ::fallocate(m_file, 0, 0, static_cast<off_t>(options.preallocate)) == 0 ? 0 : errno;
+#elif MCL_OS_FREEBSD
+	const int res = ::posix_fallocate(m_file, 0, static_cast<off_t>(options.preallocate));
+#else
+	const int res = EOPNOTSUPP;
+#endif
+	if (res == 0)
+		m_preallocated = options.preallocate;
+	else if (res == ENOSPC)
+		setError({res, std::generic_category()});
+	// Not supported by the file system: just go on without
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::isOpen() const
+{
+	return m_file != -1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::writeToFile(const std::byte* data, std::size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t res = ::write(m_file, data, size);
+		if (res < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			setError({errno, std::generic_category()});
+			return false;
+		}
+		data += res;
+		size -= static_cast<std::size_t>(res);
+		m_written += static_cast<std::size_t>(res);
+	}
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::commit()
+{
+	if (!isOpen() || m_error || !flush())
+		return false;
+
+	const auto fail = [this]() {
+		setError({errno, std::generic_category()});
+		return false;
+	};
+
+	if (m_preallocated > m_written && ::ftruncate(m_file, static_cast<off_t>(m_written)) != 0)
+		return fail();
+
+	/* Data must be on disk before the rename is, or a crash could leave the
+	target pointing to an empty or partial file. */
+
+	if (m_durable)
+	{
+#if MCL_OS_MAC
+		const bool synced = ::fcntl(m_file, F_FULLFSYNC) == 0 || ::fsync(m_file) == 0; // Plain fsync doesn't flush the drive cache on macOS
+#else
+		const bool synced = ::fsync(m_file) == 0;
+#endif
+		if (!synced)
+			return fail();
+	}
+
+	const int file = m_file;
+	m_file         = -1;
+	if (::close(file) != 0)
+		return fail();
+
+	if (::rename(m_tempPath.c_str(), m_path.c_str()) != 0)
+		return fail();
+	m_tempPath.clear();
+
+	/* Make the rename itself durable. */
+
+	if (m_durable)
+	{
+		const std::string_view dir     = dirnameView(m_path);
+		const std::string      dirPath = dir.empty() || dir == m_path ? "." : std::string(dir);
+		const int              dirFd   = ::open(dirPath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (dirFd == -1)
+			return fail();
+		const bool synced = ::fsync(dirFd) == 0;
+		::close(dirFd);
+		if (!synced)
+			return fail();
+	}
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AtomicWriter::discard()
+{
+	if (m_file != -1)
+		::close(m_file);
+	m_file = -1;
+	if (!m_tempPath.empty())
+		::unlink(m_tempPath.c_str());
+	m_tempPath.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+
+#elif MCL_OS_WINDOWS
+
+AtomicWriter::AtomicWriter(const std::string& path, const AtomicWriterOptions& options)
+: m_path(path)
+, m_bufferSize((std::max<std::size_t>(options.bufferSize, 1) + WRITER_ALIGNMENT - 1) / WRITER_ALIGNMENT * WRITER_ALIGNMENT)
+, m_durable(options.durable)
+{
+	m_buffer.reset(static_cast<std::byte*>(::operator new[](m_bufferSize, std::align_val_t{WRITER_ALIGNMENT})));
+
+	HANDLE file = INVALID_HANDLE_VALUE;
+	for (int attempt = 0; attempt < 16 && file == INVALID_HANDLE_VALUE; attempt++)
+	{
+		m_tempPath = makeTempPath_(path, writerSerial_++);
+		file       = CreateFileW(stdfs::path(m_tempPath).wstring().c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS)
+			break;
+	}
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		setError({static_cast<int>(GetLastError()), std::system_category()});
+		m_tempPath.clear();
+		return;
+	}
+	m_file = file;
+
+	if (options.preallocate == 0)
+		return;
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = static_cast<LONGLONG>(options.preallocate);
+	if (SetFileInformationByHandle(file, FileAllocationInfo, &info, sizeof(info)))
+		m_preallocated = options.preallocate;
+	else if (GetLastError() == ERROR_DISK_FULL)
+		setError({static_cast<int>(GetLastError()), std::system_category()});
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::isOpen() const
+{
+	return m_file != nullptr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::writeToFile(const std::byte* data, std::size_t size)
+{
+	while (size > 0)
+	{
+		const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(size, 1 << 30));
+		DWORD       written;
+		if (!WriteFile(static_cast<HANDLE>(m_file), data, chunk, &written, nullptr))
+		{
+			setError({static_cast<int>(GetLastError()), std::system_category()});
+			return false;
+		}
+		data += written;
+		size -= written;
+		m_written += written;
+	}
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool AtomicWriter::commit()
+{
+	if (!isOpen() || m_error || !flush())
+		return false;
+
+	const auto fail = [this]() {
+		setError({static_cast<int>(GetLastError()), std::system_category()});
+		return false;
+	};
+
+	/* No need to trim: allocation beyond the end of file is released on close. */
+
+	const HANDLE file = static_cast<HANDLE>(m_file);
+	if (m_durable && !FlushFileBuffers(file))
+		return fail();
+
+	m_file = nullptr;
+	if (!CloseHandle(file))
+		return fail();
+
+	const DWORD flags = MOVEFILE_REPLACE_EXISTING | (m_durable ? MOVEFILE_WRITE_THROUGH : 0);
+	if (!MoveFileExW(stdfs::path(m_tempPath).wstring().c_str(), stdfs::path(m_path).wstring().c_str(), flags))
+		return fail();
+	m_tempPath.clear();
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void AtomicWriter::discard()
+{
+	if (m_file != nullptr)
+		CloseHandle(static_cast<HANDLE>(m_file));
+	m_file = nullptr;
+	if (!m_tempPath.empty())
+		DeleteFileW(stdfs::path(m_tempPath).wstring().c_str());
+	m_tempPath.clear();
+}
+
+#endif
 } // namespace mcl::utils::fs
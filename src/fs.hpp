@@ -27,7 +27,17 @@
 #ifndef MONOCASUAL_UTILS_FS_H
 #define MONOCASUAL_UTILS_FS_H
 
+#include "os.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 namespace mcl::utils::fs
 {
@@ -95,6 +105,372 @@ std::string join(const std::string& a, const std::string& b);
 Returns false if the file name contains forbidden characters. */
 
 bool isValidFileName(const std::string&);
+
+/* -------------------------------------------------------------------------- */
+
+/* basenameView, dirnameView, getExtView, getStemView, stripExtView
+Allocation-free versions of basename, dirname, getExt and stripExt, plus
+getStemView (/path/to/file.txt -> file). They work lexically on the input,
+following the same rules as std::filesystem::path, and return views into it:
+the input must outlive the result. */
+
+std::string_view basenameView(std::string_view s);
+std::string_view dirnameView(std::string_view s);
+std::string_view getExtView(std::string_view s);
+std::string_view getStemView(std::string_view s);
+std::string_view stripExtView(std::string_view s);
+
+/* join (2)
+Allocation-free version of join (1): writes the result into 'buffer' and
+returns a view of it. Returns an empty view if 'buffer' is too small. */
+
+std::string_view join(std::string_view a, std::string_view b, std::span<char> buffer);
+
+/* -------------------------------------------------------------------------- */
+
+struct ScanOptions
+{
+	/* extensions
+	Only files with one of these extensions (e.g. ".wav") are reported. Case
+	insensitive. Empty = all files. */
+
+	std::vector<std::string> extensions;
+
+	/* threads
+	Number of worker threads. 0 = one per hardware thread. */
+
+	std::size_t threads = 0;
+
+	/* batchSize
+	Maximum number of paths passed to the callback at once. */
+
+	std::size_t batchSize = 256;
+
+	/* followSymlinks
+	Whether to descend into symlinked directories. Symlinked files are always
+	reported. */
+
+	bool followSymlinks = false;
+};
+
+/* ScanCallback
+Receives batches of file paths. Invoked from the worker threads, but never
+concurrently. */
+
+using ScanCallback = std::function<void(std::span<const std::string>)>;
+
+/* scan
+Recursively lists all files under 'root', walking subdirectories in parallel.
+The file type reported by the directory entries is used whenever possible, so
+that no extra stat() is needed per entry. Unreadable directories are skipped.
+Results come in no particular order. Returns the number of files found. */
+
+std::size_t scan(const std::string& root, const ScanOptions&, const ScanCallback&);
+
+/* -------------------------------------------------------------------------- */
+
+/* MappedFile
+Read-only view of a whole file's content, memory-mapped so that no copy is
+made: pages are loaded lazily by the OS as they are accessed. Files that can't
+be mapped (e.g. pipes, or virtual files reporting a size of zero) are read into
+an internal buffer instead, transparently. Check isOpen() after construction. */
+
+class MappedFile
+{
+public:
+	/* Hint
+	Expected access pattern, passed to the OS to tune read-ahead. */
+
+	enum class Hint
+	{
+		NORMAL,
+		SEQUENTIAL, // Aggressive read-ahead, pages dropped soon after use
+		RANDOM,     // No read-ahead
+		WILLNEED    // Start loading the whole file in background right away
+	};
+
+	/* Constructor (1)
+	Creates an empty, closed file. */
+
+	MappedFile() = default;
+
+	/* Constructor (2)
+	Maps file at 'path'. If 'hugePages' is true, asks the OS to back the mapping
+	with huge pages where supported (best effort, Linux only). */
+
+	explicit MappedFile(const std::string& path, Hint hint = Hint::NORMAL, bool hugePages = false);
+
+	MappedFile(const MappedFile&)            = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) noexcept;
+	MappedFile& operator=(MappedFile&&) noexcept;
+	~MappedFile();
+
+	bool isOpen() const noexcept { return m_open; }
+
+	/* isMapped
+	False if the content has been read into a buffer instead. */
+
+	bool isMapped() const noexcept { return m_mapped; }
+
+	std::size_t                getSize() const noexcept { return m_size; }
+	std::span<const std::byte> getBytes() const noexcept { return {m_data, m_size}; }
+	std::string_view           getView() const noexcept { return {reinterpret_cast<const char*>(m_data), m_size}; }
+
+	/* advise
+	Changes the access pattern hint. No-op for buffered files. */
+
+	void advise(Hint);
+
+private:
+	void close() noexcept;
+	bool readBuffered(const std::string& path);
+
+	const std::byte*       m_data   = nullptr;
+	std::size_t            m_size   = 0;
+	bool                   m_open   = false;
+	bool                   m_mapped = false;
+	std::vector<std::byte> m_buffer;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* MetadataCache
+Opt-in, thread-safe cache for fileExists, isDir, dirExists and getRealPath,
+meant for code that keeps asking about the same paths. Answers come from memory
+after the first query. Paths inside directories registered with watch() (Linux
+only, through inotify) stay cached until a change is reported; all the others
+expire after a fixed time-to-live. Paths are used as given, with no
+normalization. */
+
+class MetadataCache
+{
+public:
+	struct Stats
+	{
+		std::size_t hits          = 0;
+		std::size_t misses        = 0;
+		std::size_t invalidations = 0;
+	};
+
+	/* Constructor
+	'ttl' is the lifetime of entries not covered by a watched directory. */
+
+	explicit MetadataCache(std::chrono::milliseconds ttl = std::chrono::seconds(1));
+	MetadataCache(const MetadataCache&)            = delete;
+	MetadataCache& operator=(const MetadataCache&) = delete;
+	~MetadataCache();
+
+	bool        fileExists(const std::string&);
+	bool        dirExists(const std::string&);
+	bool        isDir(const std::string&);
+	std::string getRealPath(const std::string&);
+
+	/* watch
+	Starts watching directory 'dir' (not recursively). Entries for its direct
+	children, and for 'dir' itself, are then invalidated as soon as they are
+	created, deleted or renamed. Returns false if watching is not possible, in
+	which case the TTL applies. */
+
+	bool watch(const std::string& dir);
+
+	/* invalidate
+	Drops 'path' and everything below it from the cache. */
+
+	void invalidate(const std::string& path);
+
+	void  clear();
+	Stats getStats() const;
+
+private:
+	struct Impl;
+
+	std::unique_ptr<Impl> m_impl;
+};
+
+/* -------------------------------------------------------------------------- */
+
+struct AsyncReaderOptions
+{
+	/* preferIoUring
+	Use io_uring when the kernel supports it (Linux only). Otherwise, or if set
+	to false, reads are done by a pool of worker threads. */
+
+	bool preferIoUring = true;
+
+	/* threads
+	Number of worker threads, when not using io_uring. */
+
+	std::size_t threads = 4;
+
+	/* queueDepth
+	Maximum number of reads submitted to io_uring at once. */
+
+	std::size_t queueDepth = 32;
+
+	/* maxInFlightBytes
+	Upper bound for the memory taken by pooled buffers being filled or handed to
+	callbacks. A file larger than this is still read, but only when nothing else
+	is in flight. */
+
+	std::size_t maxInFlightBytes = 64 * 1024 * 1024;
+};
+
+/* AsyncReader
+Reads whole files concurrently, either into buffers provided by the caller or
+into pooled ones. Completions are reported through a callback, invoked from an
+internal thread (possibly from several at once), or through a future. The
+destructor waits for all pending reads. */
+
+class AsyncReader
+{
+public:
+	enum class Backend
+	{
+		THREADS,
+		IO_URING
+	};
+
+	struct Result
+	{
+		std::string path;
+
+		/* data
+		File content: points either to the caller's buffer or to 'buffer'. */
+
+		std::span<const std::byte> data;
+
+		/* buffer
+		Pooled storage. Move it out of the Result to keep it past the callback;
+		otherwise it goes back to the pool. */
+
+		std::vector<std::byte> buffer;
+
+		std::error_code error;
+	};
+
+	using Callback = std::function<void(Result&)>;
+
+	explicit AsyncReader(const AsyncReaderOptions& = {});
+	AsyncReader(const AsyncReader&)            = delete;
+	AsyncReader& operator=(const AsyncReader&) = delete;
+	~AsyncReader();
+
+	Backend getBackend() const;
+
+	/* read (1)
+	Reads all 'paths' into pooled buffers. 'callback' is invoked once per file. */
+
+	void read(std::span<const std::string> paths, Callback callback);
+
+	/* read (2)
+	Reads 'path' into 'buffer'. Fails with std::errc::value_too_large if the
+	file doesn't fit. */
+
+	void read(const std::string& path, std::span<std::byte> buffer, Callback callback);
+
+	/* read (3)
+	Reads 'path' into a pooled buffer, which is then owned by the Result. */
+
+	std::future<Result> read(const std::string& path);
+
+	/* wait
+	Blocks until all reads submitted so far have completed. */
+
+	void wait();
+
+private:
+	struct Impl;
+
+	std::unique_ptr<Impl> m_impl;
+};
+
+/* -------------------------------------------------------------------------- */
+
+struct AtomicWriterOptions
+{
+	/* bufferSize
+	Size of the write buffer. Rounded up to a multiple of the page size. */
+
+	std::size_t bufferSize = 1024 * 1024;
+
+	/* preallocate
+	If not zero, disk space for this many bytes is reserved upfront, to reduce
+	fragmentation and fail early when the disk is full. The file is trimmed to
+	the actual size on commit. */
+
+	std::size_t preallocate = 0;
+
+	/* durable
+	Flush data and directory to disk on commit. Without this the replacement is
+	still atomic for other processes, but may be lost on power failure. */
+
+	bool durable = true;
+};
+
+/* AtomicWriter
+Streams content to a temporary file in the same directory as 'path', then
+replaces 'path' with it on commit(). Readers (and a crash at any point) see
+either the old or the complete new content, never a partial write. Memory use
+is bounded by the buffer size. If commit() is not called, the destructor
+throws the temporary file away. */
+
+class AtomicWriter
+{
+public:
+	explicit AtomicWriter(const std::string& path, const AtomicWriterOptions& = {});
+	AtomicWriter(const AtomicWriter&)            = delete;
+	AtomicWriter& operator=(const AtomicWriter&) = delete;
+	~AtomicWriter();
+
+	/* isOpen
+	False if the temporary file couldn't be created. */
+
+	bool isOpen() const;
+
+	std::error_code getError() const;
+
+	/* write
+	Appends data. Returns false on error, after which all calls fail. */
+
+	bool write(std::span<const std::byte>);
+	bool write(std::string_view);
+
+	/* commit
+	Flushes everything and atomically replaces the target file. */
+
+	bool commit();
+
+	/* discard
+	Throws the temporary file away, leaving the target file untouched. */
+
+	void discard();
+
+private:
+	struct BufferDeleter
+	{
+		void operator()(std::byte* p) const noexcept;
+	};
+
+	bool flush();
+	bool writeToFile(const std::byte* data, std::size_t size);
+	void setError(std::error_code);
+
+	std::string                                 m_path;
+	std::string                                 m_tempPath;
+	std::unique_ptr<std::byte[], BufferDeleter> m_buffer;
+	std::size_t                                 m_bufferSize   = 0;
+	std::size_t                                 m_used         = 0;
+	std::size_t                                 m_written      = 0;
+	std::size_t                                 m_preallocated = 0;
+	bool                                        m_durable;
+	std::error_code                             m_error;
+#if MCL_OS_WINDOWS
+	void* m_file = nullptr;
+#else
+	int m_file = -1;
+#endif
+};
 } // namespace mcl::utils::fs
 
 #endif
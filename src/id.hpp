@@ -27,8 +27,12 @@
 #ifndef MONOCASUAL_UTILS_ID_H
 #define MONOCASUAL_UTILS_ID_H
 
+#include "os.hpp"
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <ostream>
 
 namespace mcl::utils
@@ -109,6 +113,109 @@ public:
 private:
 	std::size_t m_value{0};
 };
+
+/* -------------------------------------------------------------------------- */
+
+/* IdGenerator
+Thread-safe source of unique, valid Ids. Each thread reserves a block of
+'blockSize' consecutive Ids at a time from a shared counter, and then hands
+them out from a thread-local cache: the fast path is a couple of thread-local
+reads and writes, with no atomic read-modify-write on shared memory. As a
+consequence Ids are unique but not globally sorted by creation time, and some
+values may be skipped. */
+
+class IdGenerator
+{
+public:
+	/* Constructor
+	First Id generated will be 'last' + 1. */
+
+	explicit IdGenerator(std::size_t blockSize = 1024, Id last = Id{}) noexcept
+	: m_blockSize(blockSize)
+	, m_next(last.getValue() + 1)
+	, m_serial(s_serial.fetch_add(1, std::memory_order_relaxed) + 1)
+	{
+		assert(blockSize > 0);
+	}
+
+	IdGenerator(const IdGenerator&)            = delete;
+	IdGenerator& operator=(const IdGenerator&) = delete;
+
+	/* generate
+	Returns a new unique Id. Can be called from any thread. */
+
+	Id generate() noexcept
+	{
+		Block& block = getBlock();
+		if (block.next == block.end || block.epoch != m_epoch.load(std::memory_order_acquire))
+			refill(block);
+		return Id{block.next++};
+	}
+
+	/* reseed
+	Makes sure all Ids generated from now on are greater than 'last', e.g. the
+	largest Id found in a freshly loaded project. Never moves the counter
+	backwards, so Ids already handed out can't be generated again. Blocks
+	already reserved by other threads are discarded. Must not race with
+	generate() calls whose result could collide with the restored Ids. */
+
+	void reseed(Id last) noexcept
+	{
+		const std::size_t next    = last.getValue() + 1;
+		std::size_t       current = m_next.load(std::memory_order_relaxed);
+		while (current < next && !m_next.compare_exchange_weak(current, next, std::memory_order_relaxed))
+			;
+		m_epoch.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+	/* Block
+	Range [next, end) of Ids reserved by a thread. 'owner' is the serial number
+	of the generator it belongs to. */
+
+	struct Block
+	{
+		std::uint64_t owner = 0;
+		std::uint64_t epoch = 0;
+		std::size_t   next  = 0;
+		std::size_t   end   = 0;
+	};
+
+	/* MAX_GENERATORS_PER_THREAD
+	How many generators each thread can interleave before their blocks start
+	evicting each other (which wastes Ids but is otherwise harmless). */
+
+	static constexpr std::size_t MAX_GENERATORS_PER_THREAD = 4;
+
+	Block& getBlock() noexcept
+	{
+		static thread_local std::array<Block, MAX_GENERATORS_PER_THREAD> blocks;
+		static thread_local std::size_t                                  victim = 0;
+
+		for (Block& block : blocks)
+			if (block.owner == m_serial)
+				return block;
+
+		Block& block = blocks[victim++ % MAX_GENERATORS_PER_THREAD];
+		block        = {m_serial, 0, 0, 0};
+		return block;
+	}
+
+	void refill(Block& block) noexcept
+	{
+		block.epoch = m_epoch.load(std::memory_order_acquire);
+		block.next  = m_next.fetch_add(m_blockSize, std::memory_order_relaxed);
+		block.end   = block.next + m_blockSize;
+	}
+
+	static inline std::atomic<std::uint64_t> s_serial{0};
+
+	const std::size_t m_blockSize;
+
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> m_next;
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::uint64_t> m_epoch{1};
+	const std::uint64_t m_serial;
+};
 } // namespace mcl::utils
 
 /* std::hash<mcl::utils::Id>
@@ -25,7 +25,403 @@
  * -------------------------------------------------------------------------- */
 
 #include "log.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace mcl::utils::log
 {
+namespace
+{
+static_assert((MCL_LOG_BUFFER_SIZE & (MCL_LOG_BUFFER_SIZE - 1)) == 0, "MCL_LOG_BUFFER_SIZE must be a power of two");
+
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(10);
+
+struct Slot_
+{
+	Level       level;
+	std::size_t size;
+	char        text[MCL_LOG_MESSAGE_SIZE];
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* Buffer_
+Single-producer/single-consumer ring of message slots. The owner thread writes
+at 'tail', the drain thread reads from 'head'. Both indexes grow indefinitely
+and are wrapped with a mask. */
+
+struct Buffer_
+{
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> head{0};
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> tail{0};
+	alignas(MCL_CACHE_LINE_SIZE) std::atomic<std::size_t> dropped{0};
+	std::atomic<bool> orphan{false}; // Owner thread has exited
+	std::size_t       reportedDropped{0};
+
+	std::array<Slot_, MCL_LOG_BUFFER_SIZE> slots;
+};
+
+/* -------------------------------------------------------------------------- */
+
+void defaultSink_(Level level, std::string_view text)
+{
+	switch (level)
+	{
+	case Level::WARNING:
+		std::cerr << "[warning] ";
+		break;
+	case Level::ERROR:
+		std::cerr << "[error] ";
+		break;
+	default:
+		break;
+	}
+	std::cerr << text << '\n';
+}
+
+/* -------------------------------------------------------------------------- */
+
+class Logger_
+{
+public:
+	Logger_()
+	{
+		start();
+	}
+
+	~Logger_()
+	{
+		stop();
+	}
+
+	void start()
+	{
+		std::scoped_lock lock(m_threadMutex);
+		if (m_thread.joinable())
+			return;
+		m_running = true;
+		m_thread  = std::thread([this]() { run(); });
+	}
+
+	void stop()
+	{
+		std::scoped_lock lock(m_threadMutex);
+		if (!m_thread.joinable())
+			return;
+		{
+			std::scoped_lock runLock(m_runMutex);
+			m_running = false;
+		}
+		m_runCond.notify_one();
+		m_thread.join();
+		flush();
+	}
+
+	std::shared_ptr<Buffer_> makeBuffer()
+	{
+		auto             buffer = std::make_shared<Buffer_>();
+		std::scoped_lock lock(m_mutex);
+		m_buffers.push_back(buffer);
+		return buffer;
+	}
+
+	void setSink(Sink s)
+	{
+		std::scoped_lock lock(m_drainMutex);
+		m_sink = s ? std::move(s) : defaultSink_;
+	}
+
+	/* flush
+	Drains every buffer into the sink. Buffers whose owner thread is gone are
+	removed once empty. The sink is called without holding m_mutex, so that it
+	can log in turn (which may register a new buffer). */
+
+	void flush()
+	{
+		std::scoped_lock drainLock(m_drainMutex);
+		{
+			std::scoped_lock lock(m_mutex);
+			m_draining.assign(m_buffers.begin(), m_buffers.end());
+		}
+
+		bool written = false;
+		for (const std::shared_ptr<Buffer_>& buffer : m_draining)
+			written |= drain(*buffer);
+		m_draining.clear();
+
+		std::scoped_lock lock(m_mutex);
+		std::erase_if(m_buffers, [this](const std::shared_ptr<Buffer_>& b) {
+			if (!b->orphan.load(std::memory_order_acquire) || b->head.load() != b->tail.load(std::memory_order_acquire))
+				return false;
+			m_droppedFromRemoved += b->dropped.load(std::memory_order_relaxed);
+			return true;
+		});
+
+		if (written)
+			std::cerr.flush();
+	}
+
+	std::size_t getDroppedCount()
+	{
+		std::scoped_lock lock(m_mutex);
+		std::size_t count = m_droppedFromRemoved;
+		for (const std::shared_ptr<Buffer_>& buffer : m_buffers)
+			count += buffer->dropped.load(std::memory_order_relaxed);
+		return count;
+	}
+
+	std::atomic<Level> level{static_cast<Level>(std::min(MCL_LOG_LEVEL, 3))};
+
+private:
+	bool drain(Buffer_& buffer)
+	{
+		const std::size_t tail = buffer.tail.load(std::memory_order_acquire);
+		std::size_t       head = buffer.head.load(std::memory_order_relaxed);
+
+		if (const std::size_t dropped = buffer.dropped.load(std::memory_order_relaxed); dropped != buffer.reportedDropped)
+		{
+			std::array<char, 64> tmp;
+			const char           prefix[] = "log buffer full, messages dropped: ";
+			std::memcpy(tmp.data(), prefix, sizeof(prefix) - 1);
+			const auto res = std::to_chars(tmp.data() + sizeof(prefix) - 1, tmp.data() + tmp.size(), dropped - buffer.reportedDropped);
+			m_sink(Level::WARNING, {tmp.data(), res.ptr});
+			buffer.reportedDropped = dropped;
+		}
+
+		if (head == tail)
+			return false;
+
+		for (; head != tail; head++)
+		{
+			const Slot_& slot = buffer.slots[head & (MCL_LOG_BUFFER_SIZE - 1)];
+			m_sink(slot.level, {slot.text, slot.size});
+		}
+		buffer.head.store(head, std::memory_order_release);
+		return true;
+	}
+
+	void run()
+	{
+		std::unique_lock lock(m_runMutex);
+		while (m_running)
+		{
+			m_runCond.wait_for(lock, DRAIN_INTERVAL, [this]() { return !m_running; });
+			flush();
+		}
+	}
+
+	std::mutex                            m_mutex; // Guards buffers list
+	std::vector<std::shared_ptr<Buffer_>> m_buffers;
+	std::size_t                           m_droppedFromRemoved{0};
+
+	std::mutex                            m_drainMutex; // Guards sink and buffer heads: one consumer at a time
+	std::vector<std::shared_ptr<Buffer_>> m_draining;   // Snapshot of m_buffers being drained
+	Sink                                  m_sink{defaultSink_};
+
+	std::mutex              m_threadMutex; // Guards start/stop
+	std::mutex              m_runMutex;
+	std::condition_variable m_runCond;
+	bool                    m_running{false};
+	std::thread             m_thread;
+};
+
+/* -------------------------------------------------------------------------- */
+
+Logger_& getLogger_()
+{
+	static Logger_ logger;
+	return logger;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* ThreadBuffer_
+Thread-local handle to the thread's ring buffer. Marks the buffer as orphan on
+thread exit, so that the drain thread can dispose of it once emptied. */
+
+struct ThreadBuffer_
+{
+	~ThreadBuffer_()
+	{
+		if (buffer != nullptr)
+			buffer->orphan.store(true, std::memory_order_release);
+	}
+
+	Buffer_& get()
+	{
+		if (buffer == nullptr)
+			buffer = getLogger_().makeBuffer();
+		return *buffer;
+	}
+
+	std::shared_ptr<Buffer_> buffer;
+};
+
+thread_local ThreadBuffer_ threadBuffer_;
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+Record::Record(Level level)
+: m_slot(nullptr)
+, m_data(nullptr)
+, m_size(0)
+{
+	Buffer_&          buffer = threadBuffer_.get();
+	const std::size_t tail   = buffer.tail.load(std::memory_order_relaxed);
+
+	if (tail - buffer.head.load(std::memory_order_acquire) == MCL_LOG_BUFFER_SIZE)
+	{
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Slot_& slot = buffer.slots[tail & (MCL_LOG_BUFFER_SIZE - 1)];
+	slot.level  = level;
+	m_slot      = &slot;
+	m_data      = slot.text;
+}
+
+/* -------------------------------------------------------------------------- */
+
+Record::~Record()
+{
+	if (m_slot == nullptr)
+		return;
+
+	while (m_size > 0 && m_data[m_size - 1] == '\n')
+		m_size--;
+	static_cast<Slot_*>(m_slot)->size = m_size;
+
+	Buffer_& buffer = *threadBuffer_.buffer;
+	buffer.tail.store(buffer.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/* -------------------------------------------------------------------------- */
+
+Record& Record::operator<<(std::string_view s) noexcept
+{
+	if (m_data == nullptr)
+		return *this;
+	const std::size_t n = std::min(s.size(), MCL_LOG_MESSAGE_SIZE - m_size);
+	std::memcpy(m_data + m_size, s.data(), n);
+	m_size += n;
+	return *this;
+}
+
+Record& Record::operator<<(const char* s) noexcept
+{
+	return *this << (s != nullptr ? std::string_view(s) : std::string_view("(null)"));
+}
+
+Record& Record::operator<<(char c) noexcept
+{
+	return *this << std::string_view(&c, 1);
+}
+
+Record& Record::operator<<(bool b) noexcept
+{
+	return *this << (b ? std::string_view("true") : std::string_view("false"));
+}
+
+Record& Record::operator<<(const void* p) noexcept
+{
+	char       tmp[2 + sizeof(void*) * 2] = {'0', 'x'};
+	const auto res                        = std::to_chars(tmp + 2, std::end(tmp), reinterpret_cast<std::uintptr_t>(p), 16);
+	return *this << std::string_view(tmp, res.ptr);
+}
+
+Record& Record::operator<<(long long v) noexcept
+{
+	char       tmp[24];
+	const auto res = std::to_chars(std::begin(tmp), std::end(tmp), v);
+	return *this << std::string_view(tmp, res.ptr);
+}
+
+Record& Record::operator<<(unsigned long long v) noexcept
+{
+	char       tmp[24];
+	const auto res = std::to_chars(std::begin(tmp), std::end(tmp), v);
+	return *this << std::string_view(tmp, res.ptr);
+}
+
+Record& Record::operator<<(double v) noexcept
+{
+	char       tmp[32];
+	const auto res = std::to_chars(std::begin(tmp), std::end(tmp), v);
+	return *this << std::string_view(tmp, res.ec == std::errc() ? res.ptr : tmp);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void registerThread()
+{
+	threadBuffer_.get();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void setSink(Sink s)
+{
+	getLogger_().setSink(std::move(s));
+}
+
+/* -------------------------------------------------------------------------- */
+
+void setLevel(Level l)
+{
+	getLogger_().level.store(l, std::memory_order_relaxed);
+}
+
+Level getLevel()
+{
+	return getLogger_().level.load(std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool isEnabled(Level l)
+{
+	return l >= getLogger_().level.load(std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void start()
+{
+	getLogger_().start();
+}
+
+void stop()
+{
+	getLogger_().stop();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void flush()
+{
+	getLogger_().flush();
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t getDroppedCount()
+{
+	return getLogger_().getDroppedCount();
+}
 } // namespace mcl::utils::log
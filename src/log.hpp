@@ -27,22 +27,206 @@
 #ifndef MONOCASUAL_UTILS_LOG_H
 #define MONOCASUAL_UTILS_LOG_H
 
-#include <cstdio>
-#include <iostream>
-#include <string>
+#include "os.hpp"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string_view>
 #include <type_traits>
-#include <utility>
+
+/* MCL_LOG_LEVEL
+Minimum severity compiled into the program: 0 = DEBUG, 1 = INFO, 2 = WARNING,
+3 = ERROR, 4 = nothing. Log calls below this level are removed entirely, and
+their arguments are not evaluated. Defaults to DEBUG in debug builds and to
+INFO otherwise. */
+
+#ifndef MCL_LOG_LEVEL
+#if MCL_DEBUG_MODE
+#define MCL_LOG_LEVEL 0
+#else
+#define MCL_LOG_LEVEL 1
+#endif
+#endif
+
+/* MCL_LOG_MESSAGE_SIZE, MCL_LOG_BUFFER_SIZE
+Maximum length of a single message (longer ones are truncated) and number of
+messages each thread can queue before new ones get dropped. The latter must be
+a power of two. */
+
+#ifndef MCL_LOG_MESSAGE_SIZE
+#define MCL_LOG_MESSAGE_SIZE 256
+#endif
+
+#ifndef MCL_LOG_BUFFER_SIZE
+#define MCL_LOG_BUFFER_SIZE 256
+#endif
+
+#if MCL_OS_WINDOWS && defined(ERROR)
+#undef ERROR // From wingdi.h, clashes with Level::ERROR
+#endif
 
 namespace mcl::utils::log
 {
-#ifndef NDEBUG
-#define ML_DEBUG(x) std::cerr << __FILE__ << "::" << __func__ << "() - " << x << std::endl
-#else
-#define ML_DEBUG(x) \
-	do              \
-	{               \
+enum class Level : std::uint8_t
+{
+	DEBUG = 0,
+	INFO,
+	WARNING,
+	ERROR
+};
+
+/* Sink
+Destination of log messages, invoked by the drain thread or by flush(). The
+default one writes to std::cerr. A sink may log, but must not call flush(),
+stop() or setSink(). */
+
+using Sink = std::function<void(Level, std::string_view)>;
+
+/* Record
+A single log message. The constructor reserves a slot in the calling thread's
+ring buffer, operator<< formats arguments straight into it and the destructor
+publishes it to the drain thread. No locks and no allocations are involved,
+except for the very first message of each thread (see registerThread()) and
+for types that can only be printed through std::ostream. If the buffer is full
+the message is dropped and counted (see getDroppedCount()). */
+
+class Record
+{
+public:
+	explicit Record(Level);
+	Record(const Record&)            = delete;
+	Record& operator=(const Record&) = delete;
+	~Record();
+
+	Record& operator<<(std::string_view) noexcept;
+	Record& operator<<(const char*) noexcept;
+	Record& operator<<(char) noexcept;
+	Record& operator<<(bool) noexcept;
+	Record& operator<<(const void*) noexcept;
+	Record& operator<<(long long) noexcept;
+	Record& operator<<(unsigned long long) noexcept;
+	Record& operator<<(double) noexcept;
+
+	template <typename T>
+	    requires std::integral<T>
+	Record& operator<<(T v) noexcept
+	{
+		if constexpr (std::is_signed_v<T>)
+			return *this << static_cast<long long>(v);
+		else
+			return *this << static_cast<unsigned long long>(v);
+	}
+
+	Record& operator<<(float v) noexcept { return *this << static_cast<double>(v); }
+
+	/* operator<< (fallback)
+	Any other type printable to a std::ostream. This path allocates, so avoid it
+	on real-time threads. */
+
+	template <typename T>
+	    requires(!std::is_arithmetic_v<T> && !std::is_convertible_v<const T&, std::string_view> && !std::is_pointer_v<T>) &&
+	            requires(std::ostream& o, const T& t) { o << t; }
+	Record& operator<<(const T& v)
+	{
+		if (m_data == nullptr)
+			return *this;
+		std::ostringstream ss;
+		ss << v;
+		return *this << std::string_view(ss.str());
+	}
+
+private:
+	void*       m_slot;
+	char*       m_data;
+	std::size_t m_size;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* registerThread
+Allocates the ring buffer of the calling thread. It happens automatically on
+the first message, but real-time threads should call this during setup so that
+logging never allocates afterwards. */
+
+void registerThread();
+
+/* setSink
+Replaces the current sink. Pass an empty Sink to restore the default one. */
+
+void setSink(Sink);
+
+/* setLevel
+Runtime filter on top of MCL_LOG_LEVEL: messages below 'l' are discarded. */
+
+void  setLevel(Level l);
+Level getLevel();
+
+/* isEnabled
+Tells whether a message with level 'l' passes the runtime filter. */
+
+bool isEnabled(Level l);
+
+/* start, stop
+Control the background drain thread. It starts automatically on first use;
+stop() joins it after flushing what's left. Messages logged while stopped stay
+queued until flush() or start() are called. */
+
+void start();
+void stop();
+
+/* flush
+Synchronously writes all pending messages to the sink. */
+
+void flush();
+
+/* getDroppedCount
+Returns how many messages have been lost so far because of full buffers. */
+
+std::size_t getDroppedCount();
+} // namespace mcl::utils::log
+
+/* -------------------------------------------------------------------------- */
+
+#define ML_LOG_(level, x)                                                   \
+	do                                                                      \
+	{                                                                       \
+		if (::mcl::utils::log::isEnabled(level))                            \
+		{                                                                   \
+			::mcl::utils::log::Record mlRecord_(level);                     \
+			mlRecord_ << __FILE__ << "::" << __func__ << "() - " << x;      \
+		}                                                                   \
 	} while (0)
+
+#define ML_NOLOG_(x) \
+	do               \
+	{                \
+	} while (0)
+
+#if MCL_LOG_LEVEL <= 0
+#define ML_DEBUG(x) ML_LOG_(::mcl::utils::log::Level::DEBUG, x)
+#else
+#define ML_DEBUG(x) ML_NOLOG_(x)
+#endif
+
+#if MCL_LOG_LEVEL <= 1
+#define ML_INFO(x) ML_LOG_(::mcl::utils::log::Level::INFO, x)
+#else
+#define ML_INFO(x) ML_NOLOG_(x)
+#endif
+
+#if MCL_LOG_LEVEL <= 2
+#define ML_WARNING(x) ML_LOG_(::mcl::utils::log::Level::WARNING, x)
+#else
+#define ML_WARNING(x) ML_NOLOG_(x)
+#endif
+
+#if MCL_LOG_LEVEL <= 3
+#define ML_ERROR(x) ML_LOG_(::mcl::utils::log::Level::ERROR, x)
+#else
+#define ML_ERROR(x) ML_NOLOG_(x)
 #endif
-} // namespace mcl::utils::log
 
 #endif
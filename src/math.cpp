@@ -24,11 +24,236 @@
  *
  * -------------------------------------------------------------------------- */
 
-#include "math.h"
+#include "math.hpp"
+#include "os.hpp"
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#if MCL_CPU_SSE2
+#include <immintrin.h>
+#endif
 
 namespace mcl::utils::math
 {
+namespace
+{
+#if MCL_CPU_SSE2
+
+/* Sse2_, Avx2_
+Thin wrappers around the intrinsics needed by the block kernels below, so that
+the very same kernel can be instantiated for 4 or 8 lanes. */
+
+struct Sse2_
+{
+	using F = __m128;
+	using I = __m128i;
+
+	static constexpr std::size_t lanes = 4;
+
+	static F    load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+	static F    set(float f) { return _mm_set1_ps(f); }
+	static I    seti(std::int32_t i) { return _mm_set1_epi32(i); }
+	static F    add(F a, F b) { return _mm_add_ps(a, b); }
+	static F    sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F    mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F    min(F a, F b) { return _mm_min_ps(a, b); }
+	static F    max(F a, F b) { return _mm_max_ps(a, b); }
+	static F    lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static F    eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+	static F    nge(F a, F b) { return _mm_cmpnge_ps(a, b); }
+	static F    unord(F a, F b) { return _mm_cmpunord_ps(a, b); }
+	static F    and_(F a, F b) { return _mm_and_ps(a, b); }
+	static F    or_(F a, F b) { return _mm_or_ps(a, b); }
+	static F    select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static I    addi(I a, I b) { return _mm_add_epi32(a, b); }
+	static I    subi(I a, I b) { return _mm_sub_epi32(a, b); }
+	static I    andi(I a, I b) { return _mm_and_si128(a, b); }
+	static I    ori(I a, I b) { return _mm_or_si128(a, b); }
+	static I    srli23(I a) { return _mm_srli_epi32(a, 23); }
+	static I    slli23(I a) { return _mm_slli_epi32(a, 23); }
+	static F    asFloat(I a) { return _mm_castsi128_ps(a); }
+	static I    asInt(F a) { return _mm_castps_si128(a); }
+	static F    toFloat(I a) { return _mm_cvtepi32_ps(a); }
+	static I    toIntRound(F a) { return _mm_cvtps_epi32(a); }
+};
+
+#if MCL_CPU_AVX2
+
+struct Avx2_
+{
+	using F = __m256;
+	using I = __m256i;
+
+	static constexpr std::size_t lanes = 8;
+
+	static F    load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+	static F    set(float f) { return _mm256_set1_ps(f); }
+	static I    seti(std::int32_t i) { return _mm256_set1_epi32(i); }
+	static F    add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F    sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F    mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F    min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F    max(F a, F b) { return _mm256_max_ps(a, b); }
+	static F    lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static F    eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static F    nge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NGE_UQ); }
+	static F    unord(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_UNORD_Q); }
+	static F    and_(F a, F b) { return _mm256_and_ps(a, b); }
+	static F    or_(F a, F b) { return _mm256_or_ps(a, b); }
+	static F    select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+	static I    addi(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I    subi(I a, I b) { return _mm256_sub_epi32(a, b); }
+	static I    andi(I a, I b) { return _mm256_and_si256(a, b); }
+	static I    ori(I a, I b) { return _mm256_or_si256(a, b); }
+	static I    srli23(I a) { return _mm256_srli_epi32(a, 23); }
+	static I    slli23(I a) { return _mm256_slli_epi32(a, 23); }
+	static F    asFloat(I a) { return _mm256_castsi256_ps(a); }
+	static I    asInt(F a) { return _mm256_castps_si256(a); }
+	static F    toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+	static I    toIntRound(F a) { return _mm256_cvtps_epi32(a); }
+};
+
+using Simd_ = Avx2_;
+
+#else
+
+using Simd_ = Sse2_;
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+/* linearToDB_
+Splits 'x' into mantissa and exponent, x = m * 2^e with m in [sqrt(0.5),
+sqrt(2)), then evaluates ln(m) with the Cephes logf polynomial. The result is
+scaled by 20 / ln(10). Denormals are normalized first; zero, negative, NaN and
+infinite inputs are patched at the end to match std::log10. */
+
+template <typename S>
+typename S::F linearToDB_(typename S::F x)
+{
+	using F = typename S::F;
+
+	const F zero = S::set(0.0f);
+
+	const F isZero     = S::eq(x, zero);
+	const F isInvalid  = S::nge(x, zero); // x < 0 or NaN
+	const F isInfinity = S::eq(x, S::set(std::numeric_limits<float>::infinity()));
+	const F isDenormal = S::lt(x, S::set(std::numeric_limits<float>::min()));
+
+	/* Bring denormals into the normal range (x * 2^25) and remember the
+	offset to subtract from the exponent. */
+
+	x              = S::select(isDenormal, S::mul(x, S::set(33554432.0f)), x);
+	F exponentBias = S::and_(isDenormal, S::set(25.0f));
+
+	auto bits = S::asInt(x);
+	F    e    = S::toFloat(S::subi(S::srli23(bits), S::seti(127)));
+	e         = S::sub(e, exponentBias);
+	F m       = S::asFloat(S::ori(S::andi(bits, S::seti(0x007FFFFF)), S::seti(0x3F800000))); // [1, 2)
+
+	/* Move mantissa to [sqrt(0.5), sqrt(2)) for better accuracy around 1. */
+
+	const F isBelowSqrtHalf = S::lt(m, S::set(1.41421356237f));
+	m                       = S::select(isBelowSqrtHalf, m, S::mul(m, S::set(0.5f)));
+	e                       = S::select(isBelowSqrtHalf, e, S::add(e, S::set(1.0f)));
+	m                       = S::sub(m, S::set(1.0f));
+
+	const F z = S::mul(m, m);
+	F       p = S::set(7.0376836292E-2f);
+	p         = S::add(S::mul(p, m), S::set(-1.1514610310E-1f));
+	p         = S::add(S::mul(p, m), S::set(1.1676998740E-1f));
+	p         = S::add(S::mul(p, m), S::set(-1.2420140846E-1f));
+	p         = S::add(S::mul(p, m), S::set(1.4249322787E-1f));
+	p         = S::add(S::mul(p, m), S::set(-1.6668057665E-1f));
+	p         = S::add(S::mul(p, m), S::set(2.0000714765E-1f));
+	p         = S::add(S::mul(p, m), S::set(-2.4999993993E-1f));
+	p         = S::add(S::mul(p, m), S::set(3.3333331174E-1f));
+	p         = S::mul(S::mul(p, m), z);
+
+	p     = S::add(p, S::mul(e, S::set(-2.12194440E-4f)));
+	p     = S::sub(p, S::mul(z, S::set(0.5f)));
+	F ln  = S::add(m, p);
+	ln    = S::add(ln, S::mul(e, S::set(0.693359375f)));
+	F out = S::mul(ln, S::set(8.68588963806503655f)); // 20 / ln(10)
+
+	out = S::select(isZero, S::set(-std::numeric_limits<float>::infinity()), out);
+	out = S::select(isInfinity, S::set(std::numeric_limits<float>::infinity()), out);
+	out = S::select(isInvalid, S::set(std::numeric_limits<float>::quiet_NaN()), out);
+	return out;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* dBtoLinear_
+Computes 2^y with y = x * log2(10) / 20. 'y' is split into an integer part 'n',
+applied directly to the exponent bits, and a fractional part r in [-0.5, 0.5]
+evaluated with the Cephes exp2f polynomial. */
+
+template <typename S>
+typename S::F dBtoLinear_(typename S::F x)
+{
+	using F = typename S::F;
+
+	const F isNaN = S::unord(x, x);
+
+	F y = S::mul(x, S::set(0.166096404744368118f)); // log2(10) / 20
+	y   = S::max(S::min(y, S::set(128.0f)), S::set(-127.0f));
+
+	const auto n = S::toIntRound(y);
+	const F    r = S::sub(y, S::toFloat(n));
+
+	F p = S::set(1.535336188319500E-4f);
+	p   = S::add(S::mul(p, r), S::set(1.339887440266574E-3f));
+	p   = S::add(S::mul(p, r), S::set(9.618437357674640E-3f));
+	p   = S::add(S::mul(p, r), S::set(5.550332471162809E-2f));
+	p   = S::add(S::mul(p, r), S::set(2.402264791363012E-1f));
+	p   = S::add(S::mul(p, r), S::set(6.931472028550421E-1f));
+	p   = S::add(S::mul(p, r), S::set(1.0f));
+
+	const F scale = S::asFloat(S::slli23(S::addi(n, S::seti(127))));
+	const F out   = S::mul(p, scale);
+
+	return S::select(isNaN, x, out);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* process_
+Runs 'kernel' over the whole input, lane by lane. The leftover tail is padded
+into a temporary block, so that every element goes through the same
+approximation regardless of its position in the buffer. */
+
+template <typename S, typename Kernel>
+void process_(std::span<const float> in, std::span<float> out, Kernel kernel)
+{
+	const std::size_t size = in.size();
+	std::size_t       i    = 0;
+
+	for (; i + S::lanes <= size; i += S::lanes)
+		S::store(out.data() + i, kernel(S::load(in.data() + i)));
+
+	if (i == size)
+		return;
+
+	float tmp[S::lanes] = {};
+	for (std::size_t j = 0; i + j < size; j++)
+		tmp[j] = in[i + j];
+	S::store(tmp, kernel(S::load(tmp)));
+	for (std::size_t j = 0; i + j < size; j++)
+		out[i + j] = tmp[j];
+}
+
+#endif
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 float linearToDB(float f)
 {
 	return 20 * std::log10(f);
@@ -36,6 +261,20 @@ float linearToDB(float f)
 
 /* -------------------------------------------------------------------------- */
 
+void linearToDB(std::span<const float> in, std::span<float> out)
+{
+	assert(out.size() >= in.size());
+
+#if MCL_CPU_SSE2
+	process_<Simd_>(in, out, [](auto x) { return linearToDB_<Simd_>(x); });
+#else
+	for (std::size_t i = 0; i < in.size(); i++)
+		out[i] = linearToDB(in[i]);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
 float dBtoLinear(float f)
 {
 	return std::pow(10, f / 20.0f);
@@ -43,10 +282,24 @@ float dBtoLinear(float f)
 
 /* -------------------------------------------------------------------------- */
 
+void dBtoLinear(std::span<const float> in, std::span<float> out)
+{
+	assert(out.size() >= in.size());
+
+#if MCL_CPU_SSE2
+	process_<Simd_>(in, out, [](auto x) { return dBtoLinear_<Simd_>(x); });
+#else
+	for (std::size_t i = 0; i < in.size(); i++)
+		out[i] = dBtoLinear(in[i]);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
 int quantize(int x, int step)
 {
 	/* Source:
 	https://en.wikipedia.org/wiki/Quantization_(signal_processing)#Rounding_example */
 	return step * std::floor((x / (float)step) + 0.5f);
 }
-} // namespace mcl::utils::math
\ No newline at end of file
+} // namespace mcl::utils::math
@@ -0,0 +1,139 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Monocasual Utils
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2021-2025 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Monocasual Utils.
+ *
+ * Monocasual Utils is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Monocasual Utils is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Monocasual Utils. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+#include "memory.hpp"
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+namespace mcl::utils::memory
+{
+namespace
+{
+constexpr std::size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+constexpr std::uint64_t makeHead_(std::uint64_t tag, std::uint32_t index)
+{
+	return (tag << 32) | index;
+}
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+ArenaResource::ArenaResource(std::size_t capacity)
+: m_storage(std::make_unique<std::byte[]>(capacity))
+, m_buffer(m_storage.get())
+, m_capacity(capacity)
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+ArenaResource::ArenaResource(std::span<std::byte> buffer)
+: m_buffer(buffer.data())
+, m_capacity(buffer.size())
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ArenaResource::reset() noexcept
+{
+	m_used = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void* ArenaResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	void*       p     = m_buffer + m_used;
+	std::size_t space = m_capacity - m_used;
+	if (std::align(alignment, bytes, p, space) == nullptr)
+		throw std::bad_alloc();
+
+	m_used = m_capacity - space + bytes;
+	m_peak = std::max(m_peak, m_used);
+	return p;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+PoolResource::PoolResource(std::size_t blockSize, std::size_t blockCount, std::pmr::memory_resource* upstream)
+: m_blockSize((std::max<std::size_t>(blockSize, 1) + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT)
+, m_blockCount(blockCount)
+, m_upstream(upstream)
+, m_storage(std::make_unique<std::byte[]>(m_blockSize * blockCount))
+, m_next(std::make_unique<std::atomic<std::uint32_t>[]>(blockCount))
+, m_head(makeHead_(0, blockCount > 0 ? 0 : NO_BLOCK))
+{
+	assert(blockCount < NO_BLOCK);
+
+	for (std::size_t i = 0; i < blockCount; i++)
+		m_next[i].store(i + 1 < blockCount ? static_cast<std::uint32_t>(i + 1) : NO_BLOCK, std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void* PoolResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	if (bytes > m_blockSize || alignment > BLOCK_ALIGNMENT)
+		return m_upstream->allocate(bytes, alignment);
+
+	std::uint64_t head = m_head.load(std::memory_order_acquire);
+	while (true)
+	{
+		const auto index = static_cast<std::uint32_t>(head);
+		if (index == NO_BLOCK)
+			return m_upstream->allocate(bytes, alignment);
+
+		const std::uint32_t next = m_next[index].load(std::memory_order_relaxed);
+		if (m_head.compare_exchange_weak(head, makeHead_((head >> 32) + 1, next), std::memory_order_acquire))
+			return m_storage.get() + index * m_blockSize;
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+void PoolResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+	std::byte* const block = static_cast<std::byte*>(p);
+	if (block < m_storage.get() || block >= m_storage.get() + m_blockSize * m_blockCount)
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+		return;
+	}
+
+	const auto    index = static_cast<std::uint32_t>((block - m_storage.get()) / m_blockSize);
+	std::uint64_t head  = m_head.load(std::memory_order_relaxed);
+	do
+		m_next[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+	while (!m_head.compare_exchange_weak(head, makeHead_((head >> 32) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+}
+} // namespace mcl::utils::memory
@@ -0,0 +1,136 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Monocasual Utils
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2021-2025 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Monocasual Utils.
+ *
+ * Monocasual Utils is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Monocasual Utils is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Monocasual Utils. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+#ifndef MONOCASUAL_UTILS_MEMORY_H
+#define MONOCASUAL_UTILS_MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
+
+namespace mcl::utils::memory
+{
+/* ArenaResource
+Monotonic memory resource: allocation bumps a pointer, deallocation is a no-op
+and reset() gives all the memory back at once, e.g. at the end of each audio
+block. Runs in constant time and never touches the global heap after
+construction; when full, throws std::bad_alloc as any memory_resource must, so
+size it for the worst case (getPeak() helps). Not thread-safe: use one arena
+per thread. */
+
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+	/* ArenaResource (1)
+	Owns 'capacity' bytes, zeroed at construction so that pages are already
+	mapped when used. */
+
+	explicit ArenaResource(std::size_t capacity);
+
+	/* ArenaResource (2)
+	Uses an external buffer, which must outlive the arena. */
+
+	explicit ArenaResource(std::span<std::byte> buffer);
+
+	ArenaResource(const ArenaResource&)            = delete;
+	ArenaResource& operator=(const ArenaResource&) = delete;
+
+	/* reset
+	Releases everything allocated so far. Objects still living in the arena
+	must not be used anymore. */
+
+	void reset() noexcept;
+
+	std::size_t getCapacity() const noexcept { return m_capacity; }
+	std::size_t getUsed() const noexcept { return m_used; }
+
+	/* getPeak
+	Highest getUsed() value since construction. */
+
+	std::size_t getPeak() const noexcept { return m_peak; }
+
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void  do_deallocate(void*, std::size_t, std::size_t) override {}
+	bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	std::unique_ptr<std::byte[]> m_storage;
+	std::byte*                   m_buffer;
+	std::size_t                  m_capacity;
+	std::size_t                  m_used = 0;
+	std::size_t                  m_peak = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* PoolResource
+Fixed-size block allocator with a lock-free free list, so that allocation and
+deallocation run in constant time from any thread, real-time ones included.
+Requests that don't fit a block (too big or over-aligned), or that arrive when
+the pool is exhausted, are forwarded to 'upstream': the default one throws
+std::bad_alloc, so the global heap is never touched behind your back. */
+
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+	PoolResource(std::size_t blockSize, std::size_t blockCount,
+	    std::pmr::memory_resource* upstream = std::pmr::null_memory_resource());
+
+	PoolResource(const PoolResource&)            = delete;
+	PoolResource& operator=(const PoolResource&) = delete;
+
+	/* getBlockSize
+	Requested block size, rounded up to the alignment of std::max_align_t. */
+
+	std::size_t getBlockSize() const noexcept { return m_blockSize; }
+	std::size_t getBlockCount() const noexcept { return m_blockCount; }
+
+private:
+	/* Free list head: block index in the lower half, a tag bumped on every
+	change in the upper one, so that a stale head can't be mistaken for a
+	current one (ABA problem). Links are kept outside the blocks, so reading
+	them never races with users writing into a block. */
+
+	static constexpr std::uint32_t NO_BLOCK = std::numeric_limits<std::uint32_t>::max();
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void  do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+	bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	std::size_t                                   m_blockSize;
+	std::size_t                                   m_blockCount;
+	std::pmr::memory_resource*                    m_upstream;
+	std::unique_ptr<std::byte[]>                  m_storage;
+	std::unique_ptr<std::atomic<std::uint32_t>[]> m_next;
+	std::atomic<std::uint64_t>                    m_head;
+};
+} // namespace mcl::utils::memory
+
+#endif
@@ -0,0 +1,231 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Monocasual Utils
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2021-2025 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Monocasual Utils.
+ *
+ * Monocasual Utils is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Monocasual Utils is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Monocasual Utils. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+#include "os.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#if MCL_OS_LINUX || MCL_OS_FREEBSD || MCL_OS_MAC
+#include <pthread.h>  // pthread_setschedparam
+#include <sys/mman.h> // mlockall
+#endif
+#if MCL_OS_LINUX
+#include <fstream>
+#include <sched.h> // cpu_set_t
+#endif
+#if MCL_OS_MAC
+#include <sys/sysctl.h> // sysctlbyname
+#endif
+#if MCL_OS_WINDOWS
+#include <malloc.h> // _alloca
+#include <vector>
+#include <windows.h>
+#elif MCL_OS_LINUX || MCL_OS_MAC
+#include <alloca.h>
+#else
+#include <cstdlib> // alloca on BSD
+#endif
+#if MCL_CPU_SSE2
+#include <xmmintrin.h> // _mm_getcsr, _mm_setcsr
+#endif
+
+namespace mcl::utils::os
+{
+namespace
+{
+constexpr std::size_t STACK_PAGE_SIZE = 4096; // Smallest page size around: touching more often is harmless
+
+#if MCL_OS_LINUX
+
+/* countPhysicalCores_
+Counts distinct (package, core) pairs in sysfs. Returns 0 if the topology is
+not exposed, e.g. in some containers. */
+
+unsigned countPhysicalCores_()
+{
+	std::set<std::pair<int, int>> cores;
+	for (unsigned cpu = 0;; cpu++)
+	{
+		const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+		std::ifstream     package(dir + "physical_package_id");
+		std::ifstream     core(dir + "core_id");
+		int               packageId, coreId;
+		if (!(package >> packageId) || !(core >> coreId))
+			break;
+		cores.insert({packageId, coreId});
+	}
+	return static_cast<unsigned>(cores.size());
+}
+
+#endif
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+std::error_code setRealtimePriority(SchedPolicy policy, int priority)
+{
+#if MCL_OS_WINDOWS
+	(void)policy;
+	(void)priority;
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		return {static_cast<int>(GetLastError()), std::system_category()};
+	return {};
+#else
+	const int   native = policy == SchedPolicy::FIFO ? SCHED_FIFO : SCHED_RR;
+	sched_param param{};
+	param.sched_priority = std::clamp(priority, sched_get_priority_min(native), sched_get_priority_max(native));
+	if (const int res = pthread_setschedparam(pthread_self(), native, &param); res != 0)
+		return {res, std::generic_category()};
+	return {};
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::error_code setAffinity(std::span<const int> cpus)
+{
+	if (cpus.empty())
+		return std::make_error_code(std::errc::invalid_argument);
+
+#if MCL_OS_LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const int cpu : cpus)
+	{
+		if (cpu < 0 || cpu >= CPU_SETSIZE)
+			return std::make_error_code(std::errc::invalid_argument);
+		CPU_SET(cpu, &set);
+	}
+	if (const int res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); res != 0)
+		return {res, std::generic_category()};
+	return {};
+#elif MCL_OS_WINDOWS
+	DWORD_PTR mask = 0;
+	for (const int cpu : cpus)
+	{
+		if (cpu < 0 || cpu >= static_cast<int>(sizeof(mask) * 8))
+			return std::make_error_code(std::errc::invalid_argument);
+		mask |= DWORD_PTR{1} << cpu;
+	}
+	if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+		return {static_cast<int>(GetLastError()), std::system_category()};
+	return {};
+#else
+	return std::make_error_code(std::errc::not_supported);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::error_code lockMemory()
+{
+#if MCL_OS_WINDOWS
+	return std::make_error_code(std::errc::not_supported);
+#else
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		return {errno, std::generic_category()};
+	return {};
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::error_code unlockMemory()
+{
+#if MCL_OS_WINDOWS
+	return std::make_error_code(std::errc::not_supported);
+#else
+	if (munlockall() != 0)
+		return {errno, std::generic_category()};
+	return {};
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+void prefaultStack(std::size_t size)
+{
+#if MCL_OS_WINDOWS
+	volatile unsigned char* stack = static_cast<unsigned char*>(_alloca(size));
+#else
+	volatile unsigned char* stack = static_cast<unsigned char*>(alloca(size));
+#endif
+	for (std::size_t i = 0; i < size; i += STACK_PAGE_SIZE)
+		stack[i] = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::error_code enableDenormalFlush()
+{
+#if MCL_CPU_SSE2
+	_mm_setcsr(_mm_getcsr() | 0x8040); // FTZ (bit 15) | DAZ (bit 6)
+	return {};
+#elif defined(__aarch64__)
+	std::uint64_t fpcr;
+	asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+	asm volatile("msr fpcr, %0" : : "r"(fpcr | (std::uint64_t{1} << 24))); // FZ
+	return {};
+#else
+	return std::make_error_code(std::errc::not_supported);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+CpuCount getCpuCount()
+{
+	CpuCount count;
+	count.logical = std::max(std::thread::hardware_concurrency(), 1u);
+
+#if MCL_OS_LINUX
+	count.physical = countPhysicalCores_();
+#elif MCL_OS_MAC
+	int    physical = 0;
+	size_t size     = sizeof(physical);
+	if (sysctlbyname("hw.physicalcpu", &physical, &size, nullptr, 0) == 0)
+		count.physical = static_cast<unsigned>(physical);
+#elif MCL_OS_WINDOWS
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+	std::vector<char> buffer(length);
+	if (GetLogicalProcessorInformationEx(RelationProcessorCore, reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &length))
+	{
+		for (DWORD offset = 0; offset < length; count.physical++) // One entry per core
+			offset += reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset)->Size;
+	}
+#endif
+
+	if (count.physical == 0 || count.physical > count.logical)
+		count.physical = count.logical;
+	return count;
+}
+} // namespace mcl::utils::os
@@ -51,14 +51,101 @@
 #define MCL_OS_FREEBSD 0
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MCL_CPU_X86 1
+#else
+#define MCL_CPU_X86 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MCL_CPU_SSE2 1
+#else
+#define MCL_CPU_SSE2 0
+#endif
+
+#if defined(__AVX2__)
+#define MCL_CPU_AVX2 1
+#else
+#define MCL_CPU_AVX2 0
+#endif
+
+/* MCL_CACHE_LINE_SIZE
+Alignment that keeps data written by different threads on separate cache
+lines. A constant rather than std::hardware_destructive_interference_size,
+whose value may change with compiler flags and so must not end up in headers
+shared across translation units. */
+
+#define MCL_CACHE_LINE_SIZE 64
+
 #ifndef NDEBUG
 #define MCL_DEBUG_MODE 1
 #else
 #define MCL_DEBUG_MODE 0
 #endif
 
+#include <cstddef>
+#include <span>
+#include <system_error>
+
 namespace mcl::utils::os
 {
-}
+/* Real-time utilities
+Meant for audio and other latency-critical threads, which usually configure
+themselves right after starting. All functions act on the calling thread and
+return an empty error_code on success, std::errc::not_supported where the
+platform has no equivalent. */
+
+enum class SchedPolicy
+{
+	FIFO,
+	RR
+};
+
+/* setRealtimePriority
+Switches to the real-time policy 'policy' with 'priority' (1-99 on Linux).
+Needs CAP_SYS_NICE or a suitable RLIMIT_RTPRIO, otherwise fails with
+std::errc::operation_not_permitted. On Windows maps to the time-critical
+thread priority. */
+
+std::error_code setRealtimePriority(SchedPolicy policy, int priority);
+
+/* setAffinity
+Restricts the thread to the given logical CPUs (0-based). Linux and Windows
+only. */
+
+std::error_code setAffinity(std::span<const int> cpus);
+
+/* lockMemory, unlockMemory
+Locks all current and future pages of the process in RAM, so that real-time
+threads never hit a page fault caused by swapping. Subject to RLIMIT_MEMLOCK. */
+
+std::error_code lockMemory();
+std::error_code unlockMemory();
+
+/* prefaultStack
+Touches 'size' bytes of stack below the current frame, so that the pages are
+mapped before the real-time work starts. Best used together with lockMemory(). */
+
+void prefaultStack(std::size_t size = 256 * 1024);
+
+/* enableDenormalFlush
+Turns on flush-to-zero and denormals-are-zero in the floating point unit, to
+avoid the slow path on denormal numbers (e.g. decaying reverb tails). x86 SSE
+and ARM64 only. */
+
+std::error_code enableDenormalFlush();
+
+/* getCpuCount
+Number of physical cores and logical processors (hardware threads). Physical
+falls back to logical when the topology is not available. */
+
+struct CpuCount
+{
+	unsigned physical = 0;
+	unsigned logical  = 0;
+};
+
+CpuCount getCpuCount();
+} // namespace mcl::utils::os
 
 #endif
@@ -25,85 +25,415 @@
  * -------------------------------------------------------------------------- */
 
 #include "string.hpp"
+#include "container.hpp"
+#include <bit>
+#include <cassert>
+#include <charconv>
 #include <climits>
 #include <cstdarg>
 #include <iomanip>
+#include <system_error>
 #include <vector>
 
 namespace mcl::utils::string
 {
-std::string trim(const std::string& s)
+namespace
 {
-	std::size_t first = s.find_first_not_of(" \n\t");
-	std::size_t last  = s.find_last_not_of(" \n\t");
-	return s.substr(first, last - first + 1);
+constexpr std::string_view WHITESPACE_ = " \n\t\r\f\v";
+
+/* fromChars_
+Wraps std::from_chars, adding support for a leading '+' like std::stof and
+std::stoi do. */
+
+template <typename T>
+std::from_chars_result fromChars_(const char* first, const char* last, T& value)
+{
+	if (first != last && *first == '+' && last - first > 1 && *(first + 1) != '-' && *(first + 1) != '+')
+		first++;
+	return std::from_chars(first, last, value);
 }
 
 /* -------------------------------------------------------------------------- */
 
-std::string replace(std::string in, const std::string& search, const std::string& replace)
+/* parse_
+Parses a number of type T out of 's', skipping leading whitespace. If 'strict'
+is true, only trailing whitespace is allowed after the number. */
+
+template <typename T>
+std::optional<T> parse_(std::string_view s, bool strict)
+{
+	const std::size_t first = s.find_first_not_of(WHITESPACE_);
+	if (first == std::string_view::npos)
+		return {};
+
+	const char* end = s.data() + s.size();
+	T           value;
+	const auto  res = fromChars_(s.data() + first, end, value);
+	if (res.ec != std::errc())
+		return {};
+	if (strict && s.find_first_not_of(WHITESPACE_, res.ptr - s.data()) != std::string_view::npos)
+		return {};
+	return value;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* parseMany_
+Single-pass batch parser behind parseFloats and parseInts. Each field is fed to
+std::from_chars directly; a field is valid if the parser stops exactly at the
+next separator (or at the end of the buffer). */
+
+template <typename T>
+ParseResult parseMany_(std::string_view in, std::string_view sep, std::span<T> out, T fallback)
 {
-	std::size_t pos = 0;
-	while ((pos = in.find(search, pos)) != std::string::npos)
+	ParseResult result;
+
+	const char* it  = in.data();
+	const char* end = in.data() + in.size();
+
+	const auto isSep = [sep](char c) { return sep.find(c) != std::string_view::npos; };
+
+	while (result.count < out.size())
 	{
-		in.replace(pos, search.length(), replace);
-		pos += replace.length();
+		while (it != end && isSep(*it))
+			it++;
+		if (it == end)
+			break;
+
+		T          value;
+		const auto res = fromChars_(it, end, value);
+		if (res.ec == std::errc() && (res.ptr == end || isSep(*res.ptr)))
+		{
+			out[result.count++] = value;
+			it                  = res.ptr;
+			continue;
+		}
+
+		out[result.count++] = fallback;
+		result.errors++;
+		while (it != end && !isSep(*it))
+			it++;
 	}
-	return in;
+
+	return result;
 }
+} // namespace
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-bool contains(const std::string& s, char c)
+std::string trim(const std::string& s)
 {
-	return s.find(c) != std::string::npos;
+	std::size_t first = s.find_first_not_of(" \n\t");
+	std::size_t last  = s.find_last_not_of(" \n\t");
+	return s.substr(first, last - first + 1);
 }
 
 /* -------------------------------------------------------------------------- */
 
-std::vector<std::string> split(const std::string& in, const std::string& sep)
+std::string replace(std::string in, const std::string& search, const std::string& replace)
 {
-	std::vector<std::string> out;
-	std::string              full  = in;
-	std::string              token = "";
-	std::size_t              curr  = 0;
-	std::size_t              next  = -1;
-	do
+	if (search.empty())
+		return in;
+
+	std::size_t count = 0;
+	for (std::size_t pos = in.find(search); pos != std::string::npos; pos = in.find(search, pos + search.size()))
+		count++;
+	if (count == 0)
+		return in;
+
+	if (search.size() == replace.size()) // Nothing to shift: overwrite in place
+	{
+		for (std::size_t pos = in.find(search); pos != std::string::npos; pos = in.find(search, pos + search.size()))
+			in.replace(pos, search.size(), replace);
+		return in;
+	}
+
+	std::string out;
+	out.reserve(in.size() - count * search.size() + count * replace.size());
+
+	std::size_t copied = 0;
+	for (std::size_t pos = in.find(search); pos != std::string::npos; pos = in.find(search, pos + search.size()))
 	{
-		curr  = next + 1;
-		next  = full.find_first_of(sep, curr);
-		token = full.substr(curr, next - curr);
-		if (token != "")
-			out.push_back(token);
-	} while (next != std::string::npos);
+		out.append(in, copied, pos - copied).append(replace);
+		copied = pos + search.size();
+	}
+	out.append(in, copied);
 	return out;
 }
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-float toFloat(const std::string& s)
+Replacer::Replacer(const Pairs& pairs)
+: m_pairs(pairs)
 {
-	try
+	/* Alphabet classes: 0 for bytes not used in any pattern. */
+
+	for (const auto& [search, _] : m_pairs)
+		for (const char c : search)
+			if (std::uint16_t& cls = m_classes[static_cast<unsigned char>(c)]; cls == 0)
+				cls = static_cast<std::uint16_t>(m_alphabet++);
+
+	m_alphabet = std::bit_ceil(m_alphabet);
+	m_rowShift = std::countr_zero(m_alphabet);
+
+	/* Trie of the patterns, with 0 as the root and NO_MATCH for missing
+	edges. */
+
+	std::size_t maxStates = 1;
+	for (const auto& [search, _] : m_pairs)
+		maxStates += search.size();
+	m_next.assign(maxStates * m_alphabet, NO_MATCH);
+	m_output.assign(maxStates, NO_MATCH);
+	m_depth.assign(maxStates, 0);
+
+	std::uint32_t states = 1;
+	for (std::size_t i = 0; i < m_pairs.size(); i++)
 	{
-		return std::stof(s);
+		const std::string& search = m_pairs[i].first;
+		if (search.empty())
+			continue;
+		std::uint32_t state = 0;
+		for (const char c : search)
+		{
+			std::uint32_t& next = m_next[state * m_alphabet + m_classes[static_cast<unsigned char>(c)]];
+			if (next == NO_MATCH)
+			{
+				next           = states++;
+				m_depth[next] = m_depth[state] + 1;
+			}
+			state = next;
+		}
+		if (m_output[state] == NO_MATCH)
+			m_output[state] = static_cast<std::uint32_t>(i);
 	}
-	catch (const std::exception&)
+	m_next.resize(states * m_alphabet);
+	m_output.resize(states);
+	m_depth.resize(states);
+
+	/* A state that ends its own pattern and has no children can't be extended
+	nor beaten by a match starting further left: it's reported immediately. */
+
+	std::vector<bool> isFinal(states);
+	for (std::uint32_t state = 0; state < states; state++)
+		isFinal[state] = m_output[state] != NO_MATCH &&
+		                 std::all_of(&m_next[state * m_alphabet], &m_next[state * m_alphabet] + m_alphabet, [](std::uint32_t n) { return n == NO_MATCH; });
+
+	/* Turn the trie into a DFA, breadth first: missing edges are borrowed
+	from the failure state (the longest proper suffix that's also in the
+	trie), and so is the output of states that don't end a pattern
+	themselves. */
+
+	std::vector<std::uint32_t> fail(states, 0);
+	std::vector<std::uint32_t> queue;
+	queue.reserve(states);
+	for (std::size_t c = 0; c < m_alphabet; c++)
+	{
+		std::uint32_t& next = m_next[c];
+		if (next == NO_MATCH)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+	for (std::size_t head = 0; head < queue.size(); head++)
 	{
-		return 0.0f;
+		const std::uint32_t state = queue[head];
+		if (m_output[state] == NO_MATCH)
+			m_output[state] = m_output[fail[state]];
+		for (std::size_t c = 0; c < m_alphabet; c++)
+		{
+			std::uint32_t&      next     = m_next[state * m_alphabet + c];
+			const std::uint32_t fallback = m_next[fail[state] * m_alphabet + c];
+			if (next == NO_MATCH)
+				next = fallback;
+			else
+			{
+				fail[next] = fallback;
+				queue.push_back(next);
+			}
+		}
 	}
+
+	/* State indexes to row offsets, flagging states that end a pattern. */
+
+	assert(states * m_alphabet < MATCH_FLAG);
+	for (std::uint32_t& next : m_next)
+		next = static_cast<std::uint32_t>(next * m_alphabet) | (m_output[next] != NO_MATCH ? MATCH_FLAG : 0);
+	for (std::uint32_t state = 0; state < states; state++)
+		if (isFinal[state])
+			m_output[state] |= FINAL_FLAG;
+	for (std::size_t b = 0; b < m_skip.size(); b++)
+		m_skip[b] = m_next[m_classes[b]] == 0;
 }
 
 /* -------------------------------------------------------------------------- */
 
-int toInt(const std::string& s)
+Replacer::Replacer(std::initializer_list<Pairs::value_type> pairs)
+: Replacer(Pairs(pairs))
 {
-	try
+}
+
+/* -------------------------------------------------------------------------- */
+
+template <typename F>
+void Replacer::scan(std::string_view in, F&& onMatch) const
+{
+	const char*          data = in.data();
+	const std::size_t    size = in.size();
+	const std::uint32_t* next = m_next.data();
+
+	/* A match is kept pending while the automaton can still extend it, or
+	find another one starting further left: that's possible as long as the
+	text matched by the current state begins at or before the pending start.
+	Once reported, scanning restarts right after it. */
+
+	std::uint32_t state        = 0;
+	std::uint32_t pending      = NO_MATCH;
+	std::size_t   pendingStart = 0;
+	std::size_t   pendingEnd   = 0;
+	for (std::size_t i = 0; i < size || pending != NO_MATCH; i++)
 	{
-		return std::stoi(s);
+		if (state == 0 && pending == NO_MATCH) // Fast forward to the next byte that can start a match
+		{
+			while (i < size && m_skip[static_cast<unsigned char>(data[i])])
+				i++;
+			if (i == size)
+				break;
+		}
+		const std::uint32_t transition = i < size ? next[state + m_classes[static_cast<unsigned char>(data[i])]] : 0;
+		state                          = transition & ~MATCH_FLAG;
+		if (pending != NO_MATCH && i + 1 - m_depth[state >> m_rowShift] > pendingStart) // Also at the end of the input
+		{
+			onMatch(pendingEnd, pending);
+			pending = NO_MATCH;
+			state   = 0;
+			i       = pendingEnd - 1;
+			continue;
+		}
+		if (transition & MATCH_FLAG)
+		{
+			const std::uint32_t output = m_output[state >> m_rowShift];
+			const std::uint32_t match  = output & ~FINAL_FLAG;
+			const std::size_t   start  = i + 1 - m_pairs[match].first.size();
+			if (pending == NO_MATCH && (output & FINAL_FLAG))
+			{
+				onMatch(i + 1, match);
+				state = 0;
+			}
+			else if (pending == NO_MATCH || start <= pendingStart) // Same start: this one is longer
+			{
+				pending      = match;
+				pendingStart = start;
+				pendingEnd   = i + 1;
+			}
+		}
 	}
-	catch (const std::exception&)
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string Replacer::apply(std::string_view in) const
+{
+	/* Collect the matches in a single scan, to size the output exactly. */
+
+	container::SmallVector<std::pair<std::size_t, std::uint32_t>, 32> matches;
+	std::size_t                                                        size = in.size();
+	scan(in, [this, &matches, &size](std::size_t end, std::uint32_t match) {
+		matches.emplace_back(end, match);
+		size = size - m_pairs[match].first.size() + m_pairs[match].second.size();
+	});
+
+	std::string out(size, '\0');
+	char*       dest   = out.data();
+	std::size_t copied = 0;
+	for (const auto& [end, match] : matches)
 	{
-		return 0;
+		const auto& [search, replace] = m_pairs[match];
+		const std::size_t start       = end - search.size();
+		dest                          = std::copy(in.data() + copied, in.data() + start, dest);
+		dest                          = std::copy(replace.begin(), replace.end(), dest);
+		copied                        = end;
 	}
+	std::copy(in.data() + copied, in.data() + in.size(), dest);
+	return out;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::string replaceAll(std::string_view in, const Replacer::Pairs& pairs)
+{
+	return Replacer(pairs).apply(in);
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool contains(const std::string& s, char c)
+{
+	return s.find(c) != std::string::npos;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::vector<std::string> split(const std::string& in, const std::string& sep)
+{
+	std::vector<std::string> out;
+	for (std::string_view token : splitView(in, sep))
+		out.emplace_back(token);
+	return out;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::pmr::vector<std::pmr::string> split(std::string_view in, std::string_view sep, std::pmr::memory_resource* resource)
+{
+	std::pmr::vector<std::pmr::string> out(resource);
+	for (std::string_view token : splitView(in, sep))
+		out.emplace_back(token);
+	return out;
+}
+
+/* -------------------------------------------------------------------------- */
+
+float toFloat(std::string_view s)
+{
+	return parse_<float>(s, /*strict=*/false).value_or(0.0f);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int toInt(std::string_view s)
+{
+	return parse_<int>(s, /*strict=*/false).value_or(0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<float> parseFloat(std::string_view s)
+{
+	return parse_<float>(s, /*strict=*/true);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::optional<int> parseInt(std::string_view s)
+{
+	return parse_<int>(s, /*strict=*/true);
+}
+
+/* -------------------------------------------------------------------------- */
+
+ParseResult parseFloats(std::string_view in, std::string_view sep, std::span<float> out, float fallback)
+{
+	return parseMany_(in, sep, out, fallback);
+}
+
+/* -------------------------------------------------------------------------- */
+
+ParseResult parseInts(std::string_view in, std::string_view sep, std::span<int> out, int fallback)
+{
+	return parseMany_(in, sep, out, fallback);
 }
 } // namespace mcl::utils::string
@@ -27,28 +27,246 @@
 #ifndef MONOCASUAL_UTILS_STRING_H
 #define MONOCASUAL_UTILS_STRING_H
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <ranges>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace mcl::utils::string
 {
+/* replace
+Replaces all non-overlapping occurrences of 'search', left to right. Runs in
+linear time: matches are counted first, so that the output is sized once and
+filled by copying segments. Returns 'in' unchanged if 'search' is empty. */
+
 std::string replace(std::string in, const std::string& search,
     const std::string& replace);
 
+/* -------------------------------------------------------------------------- */
+
+/* Replacer
+Applies many search/replace pairs in a single scan, no matter how many pairs
+there are. Built once from the pairs into an Aho-Corasick automaton, then
+apply() can be called any number of times, from any thread. Matches never
+overlap: the leftmost one wins (the longest one, on ties) and scanning restarts
+right after it. Replacements are not scanned again. Time is linear with the
+input size, except that the text following a match may be scanned again when
+a longer pattern was tried there, i.e. at most the longest pattern's length per
+match. Empty search strings are ignored; for duplicates the first pair wins. */
+
+class Replacer
+{
+public:
+	using Pairs = std::vector<std::pair<std::string, std::string>>;
+
+	explicit Replacer(const Pairs&);
+	explicit Replacer(std::initializer_list<Pairs::value_type>);
+
+	std::string apply(std::string_view in) const;
+
+private:
+	static constexpr std::uint32_t NO_MATCH   = std::numeric_limits<std::uint32_t>::max();
+	static constexpr std::uint32_t MATCH_FLAG = 1u << 31;
+	static constexpr std::uint32_t FINAL_FLAG = 1u << 31; // In m_output, see scan()
+
+	/* scan
+	Calls 'onMatch(end, pair index)' for each match, left to right. */
+
+	template <typename F>
+	void scan(std::string_view in, F&& onMatch) const;
+
+	/* The alphabet is compressed to the bytes that appear in the patterns,
+	plus one class for all the others: the transition table is states *
+	classes, instead of states * 256. Transitions hold the offset of the
+	target row, with MATCH_FLAG set if the target ends a pattern, so that the
+	inner loop needs no multiplication nor extra lookup. Rows are padded to a
+	power of two, so that offsets turn back into states with a shift. */
+
+	std::array<std::uint16_t, 256> m_classes{};
+	std::array<bool, 256>          m_skip{}; // Bytes that can't start a match
+	std::size_t                    m_alphabet = 1;
+	int                            m_rowShift = 0; // Rows are padded to a power of two, see above
+	std::vector<std::uint32_t>     m_next;         // Row offset + class -> row offset | MATCH_FLAG
+	std::vector<std::uint32_t>     m_output;       // State -> longest pattern ending there | FINAL_FLAG, or NO_MATCH
+	std::vector<std::uint32_t>     m_depth;        // State -> length of the text it matches
+	Pairs                          m_pairs;
+};
+
+/* replaceAll
+Shortcut for a one-off Replacer. Build a Replacer instead to apply the same
+pairs over and over. */
+
+std::string replaceAll(std::string_view in, const Replacer::Pairs& pairs);
+
+/* -------------------------------------------------------------------------- */
+
 std::string trim(const std::string& s);
 
+/* split (1)
+Splits 'in' into tokens. Any character in 'sep' acts as a delimiter; empty
+tokens are skipped. */
+
 std::vector<std::string> split(const std::string& in, const std::string& sep);
 
+/* split (2)
+Same as (1), with the vector and the tokens allocated from 'resource'. Takes
+views, so that literals and substrings don't go through a heap-allocated
+std::string first. */
+
+std::pmr::vector<std::pmr::string> split(std::string_view in, std::string_view sep, std::pmr::memory_resource* resource);
+
+/* SplitView
+Lazy range of the tokens produced by split(), as views into the original
+string. Nothing is allocated: tokens are found one at a time while iterating.
+The input string must outlive the range. */
+
+class SplitView : public std::ranges::view_interface<SplitView>
+{
+public:
+	class Iterator
+	{
+	public:
+		using value_type        = std::string_view;
+		using difference_type   = std::ptrdiff_t;
+		using iterator_category = std::forward_iterator_tag;
+
+		Iterator() = default;
+
+		constexpr Iterator(std::string_view in, std::string_view sep, std::size_t pos) noexcept
+		: m_in(in)
+		, m_sep(sep)
+		{
+			find(pos);
+		}
+
+		constexpr std::string_view operator*() const noexcept { return m_in.substr(m_begin, m_end - m_begin); }
+
+		constexpr Iterator& operator++() noexcept
+		{
+			find(m_end);
+			return *this;
+		}
+
+		constexpr Iterator operator++(int) noexcept
+		{
+			Iterator tmp{*this};
+			++(*this);
+			return tmp;
+		}
+
+		constexpr bool operator==(const Iterator& o) const noexcept { return m_begin == o.m_begin; }
+		constexpr bool operator==(std::default_sentinel_t) const noexcept { return m_begin == std::string_view::npos; }
+
+	private:
+		/* find
+		Moves to the next non-empty token starting from 'pos'. */
+
+		constexpr void find(std::size_t pos) noexcept
+		{
+			m_begin = m_in.find_first_not_of(m_sep, pos);
+			m_end   = m_begin == std::string_view::npos ? m_begin : std::min(m_in.find_first_of(m_sep, m_begin), m_in.size());
+		}
+
+		std::string_view m_in;
+		std::string_view m_sep;
+		std::size_t      m_begin = std::string_view::npos;
+		std::size_t      m_end   = std::string_view::npos;
+	};
+
+	SplitView() = default;
+
+	constexpr SplitView(std::string_view in, std::string_view sep) noexcept
+	: m_in(in)
+	, m_sep(sep)
+	{
+	}
+
+	constexpr Iterator               begin() const noexcept { return {m_in, m_sep, 0}; }
+	constexpr std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	std::string_view m_in;
+	std::string_view m_sep;
+};
+
+/* splitView (1)
+Returns a lazy range of tokens, same semantics as split(). */
+
+constexpr SplitView splitView(std::string_view in, std::string_view sep) noexcept
+{
+	return {in, sep};
+}
+
+/* splitView (2)
+Calls 'func' with each token, same semantics as split(). */
+
+template <typename F>
+constexpr void splitView(std::string_view in, std::string_view sep, F&& func)
+{
+	for (std::string_view token : splitView(in, sep))
+		func(token);
+}
+
+/* split (3)
+Same as (1), into any container with emplace_back(), e.g. a
+container::SmallVector<std::string_view, 8> that doesn't allocate at all for
+short inputs. String views point into 'in', which must outlive them. */
+
+template <typename Out>
+Out split(std::string_view in, std::string_view sep)
+{
+	Out out;
+	splitView(in, sep, [&out](std::string_view token) { out.emplace_back(token); });
+	return out;
+}
+
 /* contains
 Returns true if the string in input contains the specified character. */
 
 bool contains(const std::string&, char);
 
 /* toFloat, toInt
-Convert a string to numbers. Like std::stof, std::stoi, just safer. */
+Convert a string to numbers. Like std::stof, std::stoi (leading whitespace and
+trailing garbage are ignored), but return 0 on failure instead of throwing.
+Locale-independent: the decimal separator is always '.'. */
+
+float toFloat(std::string_view);
+int   toInt(std::string_view);
+
+/* parseFloat, parseInt
+Strict versions of toFloat, toInt: the whole string, surrounding whitespace
+aside, must be a valid number in range. Never throw; return an empty optional
+on failure. */
+
+std::optional<float> parseFloat(std::string_view);
+std::optional<int>   parseInt(std::string_view);
+
+/* parseFloats, parseInts
+Parse a buffer of numbers delimited by any char of 'sep' into 'out', in a
+single pass with no allocations. Empty fields are skipped like in split();
+malformed or out-of-range fields are written as 'fallback'. Stops when 'out'
+is full. Returns how many numbers have been written and how many fields were
+malformed. */
+
+struct ParseResult
+{
+	std::size_t count  = 0;
+	std::size_t errors = 0;
+};
 
-float toFloat(const std::string&);
-int   toInt(const std::string&);
+ParseResult parseFloats(std::string_view in, std::string_view sep, std::span<float> out, float fallback = 0.0f);
+ParseResult parseInts(std::string_view in, std::string_view sep, std::span<int> out, int fallback = 0);
 } // namespace mcl::utils::string
 
 #endif
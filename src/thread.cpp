@@ -0,0 +1,197 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Monocasual Utils
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2021-2025 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Monocasual Utils.
+ *
+ * Monocasual Utils is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Monocasual Utils is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Monocasual Utils. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+#include "thread.hpp"
+#include "os.hpp"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace mcl::utils::thread
+{
+namespace
+{
+constexpr std::size_t NO_WORKER = static_cast<std::size_t>(-1);
+
+/* Set on worker threads, to route tasks submitted from inside a task to the
+worker's own deque. */
+
+thread_local const ThreadPool* currentPool_  = nullptr;
+thread_local std::size_t       currentIndex_ = NO_WORKER;
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+/* Worker
+The deques are guarded by a mutex: it's almost always uncontended, as the
+owner works at the back and thieves only show up at the front when they have
+nothing else to do. */
+
+struct ThreadPool::Worker
+{
+	std::mutex                                    mutex;
+	std::array<std::deque<TaskBase*>, PRIORITIES> tasks;
+	std::thread                                   thread;
+};
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::ThreadPool(std::size_t threads, std::size_t queueCapacity)
+{
+	if (threads == 0)
+		threads = std::max(os::getCpuCount().physical, 1u);
+
+	for (auto& queue : m_queues)
+		queue = std::make_unique<container::MpmcQueue<TaskBase*>>(queueCapacity);
+
+	m_workers.reserve(threads);
+	for (std::size_t i = 0; i < threads; i++)
+		m_workers.push_back(std::make_unique<Worker>());
+	for (std::size_t i = 0; i < threads; i++) // Start only when all deques exist, as workers steal from each other
+		m_workers[i]->thread = std::thread([this, i] { work(i); });
+}
+
+/* -------------------------------------------------------------------------- */
+
+ThreadPool::~ThreadPool()
+{
+	m_stopping.store(true);
+	m_wake.fetch_add(1);
+	m_wake.notify_all();
+	for (auto& worker : m_workers)
+		worker->thread.join();
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t ThreadPool::getSize() const
+{
+	return m_workers.size();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::push(TaskBase* task, Priority priority)
+{
+	const auto p = static_cast<std::size_t>(priority);
+
+	if (currentPool_ == this)
+	{
+		Worker&          worker = *m_workers[currentIndex_];
+		std::scoped_lock lock(worker.mutex);
+		worker.tasks[p].push_back(task);
+	}
+	else
+	{
+		while (!m_queues[p]->push(task))
+			std::this_thread::yield();
+	}
+
+	/* Bump the wake counter before looking for sleepers: a worker about to
+	park increments m_sleeping before reading m_wake, so either it sees the
+	new value and doesn't park, or this sees it sleeping and wakes it up. */
+
+	m_wake.fetch_add(1);
+	if (m_sleeping.load() > 0)
+		m_wake.notify_one();
+}
+
+/* -------------------------------------------------------------------------- */
+
+TaskBase* ThreadPool::findTask(std::size_t index)
+{
+	TaskBase* task = nullptr;
+
+	for (std::size_t p = 0; p < PRIORITIES; p++)
+	{
+		{
+			Worker&          self = *m_workers[index];
+			std::scoped_lock lock(self.mutex);
+			if (!self.tasks[p].empty())
+			{
+				task = self.tasks[p].back();
+				self.tasks[p].pop_back();
+				return task;
+			}
+		}
+
+		if (m_queues[p]->pop(task))
+			return task;
+
+		for (std::size_t i = 1; i < m_workers.size(); i++)
+		{
+			Worker&          victim = *m_workers[(index + i) % m_workers.size()];
+			std::scoped_lock lock(victim.mutex);
+			if (!victim.tasks[p].empty())
+			{
+				task = victim.tasks[p].front();
+				victim.tasks[p].pop_front();
+				return task;
+			}
+		}
+	}
+	return nullptr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ThreadPool::work(std::size_t index)
+{
+	currentPool_  = this;
+	currentIndex_ = index;
+
+	while (true)
+	{
+		TaskBase* task = findTask(index);
+		if (task == nullptr)
+		{
+			if (m_stopping.load())
+				return;
+
+			/* Announce the intention to park, then look again: a task pushed
+			in between is either found here or bumps m_wake, so the wait
+			returns immediately (see push()). */
+
+			m_sleeping.fetch_add(1);
+			const std::uint32_t wake = m_wake.load();
+			task                     = findTask(index);
+			if (task == nullptr && !m_stopping.load())
+				m_wake.wait(wake);
+			m_sleeping.fetch_sub(1);
+
+			if (task == nullptr)
+				continue;
+		}
+		task->run();
+		task->release();
+	}
+}
+} // namespace mcl::utils::thread
@@ -0,0 +1,263 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Monocasual Utils
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2021-2025 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Monocasual Utils.
+ *
+ * Monocasual Utils is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Monocasual Utils is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Monocasual Utils. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+#ifndef MONOCASUAL_UTILS_THREAD_H
+#define MONOCASUAL_UTILS_THREAD_H
+
+#include "container.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace mcl::utils::thread
+{
+/* Priority
+Ready tasks of a higher priority are always picked before lower ones. There's
+no preemption: a running task is never interrupted. */
+
+enum class Priority
+{
+	HIGH,
+	NORMAL,
+	LOW
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* TaskBase
+Type-erased unit of work, reference counted: the pool holds a reference until
+the task has run, its Future holds another one. */
+
+class TaskBase
+{
+public:
+	virtual ~TaskBase() = default;
+
+	virtual void run() = 0;
+
+	void retain() noexcept { m_refs.fetch_add(1, std::memory_order_relaxed); }
+
+	void release() noexcept
+	{
+		if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete this;
+	}
+
+private:
+	std::atomic<int> m_refs{1};
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* TaskState
+Result slot of a task returning T. Completion is signalled through an atomic
+wait, so waiting for a result costs no mutex nor condition variable. */
+
+template <typename T>
+class TaskState : public TaskBase
+{
+public:
+	bool isReady() const noexcept { return m_ready.load(std::memory_order_acquire) != 0; }
+
+	void wait() const noexcept
+	{
+		while (m_ready.load(std::memory_order_acquire) == 0)
+			m_ready.wait(0, std::memory_order_acquire);
+	}
+
+	T get()
+	{
+		wait();
+		if (m_error)
+			std::rethrow_exception(m_error);
+		if constexpr (!std::is_void_v<T>)
+			return std::move(*m_value);
+	}
+
+protected:
+	template <typename F>
+	void complete(F& f) noexcept
+	{
+		try
+		{
+			if constexpr (std::is_void_v<T>)
+				std::invoke(f);
+			else
+				m_value.emplace(std::invoke(f));
+		}
+		catch (...)
+		{
+			m_error = std::current_exception();
+		}
+		m_ready.store(1, std::memory_order_release);
+		m_ready.notify_all();
+	}
+
+private:
+	using Storage = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+	std::atomic<std::uint32_t> m_ready{0};
+	std::optional<Storage>     m_value;
+	std::exception_ptr         m_error;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* Future
+Handle to the result of a task submitted to a ThreadPool. Move-only, like
+std::future, but without its shared state allocation: the result lives in the
+task itself. get() can be called once; it rethrows whatever the task threw.
+Don't wait on a future from inside a task of the same pool: if all workers do
+that, nobody is left to run the task being waited for. */
+
+template <typename T>
+class Future
+{
+public:
+	Future() = default;
+
+	explicit Future(TaskState<T>* state)
+	: m_state(state)
+	{
+	}
+
+	Future(const Future&)            = delete;
+	Future& operator=(const Future&) = delete;
+
+	Future(Future&& o) noexcept
+	: m_state(std::exchange(o.m_state, nullptr))
+	{
+	}
+
+	Future& operator=(Future&& o) noexcept
+	{
+		if (this != &o)
+		{
+			if (m_state != nullptr)
+				m_state->release();
+			m_state = std::exchange(o.m_state, nullptr);
+		}
+		return *this;
+	}
+
+	~Future()
+	{
+		if (m_state != nullptr)
+			m_state->release();
+	}
+
+	bool isValid() const { return m_state != nullptr; }
+	bool isReady() const { return m_state->isReady(); }
+	void wait() const { m_state->wait(); }
+	T    get() { return m_state->get(); }
+
+private:
+	TaskState<T>* m_state = nullptr;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* ThreadPool
+Work-stealing pool. Each worker owns one deque per priority: tasks submitted
+from inside a task go to the current worker's deque and are run LIFO, while
+cache is still warm; idle workers steal the oldest ones from the others.
+Tasks submitted from outside go through a bounded lock-free MPMC queue per
+priority. Idle workers park on an atomic wait instead of spinning, and are
+woken only when there's somebody to wake. The destructor runs all the pending
+tasks before joining. */
+
+class ThreadPool
+{
+public:
+	/* ThreadPool
+	Spawns 'threads' workers, or one per physical core if 0. 'queueCapacity'
+	bounds each external submission queue: when full, submit() from outside
+	the pool yields until the workers catch up. */
+
+	explicit ThreadPool(std::size_t threads = 0, std::size_t queueCapacity = 4096);
+	ThreadPool(const ThreadPool&)            = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	std::size_t getSize() const;
+
+	template <typename F>
+	auto submit(F&& f, Priority priority = Priority::NORMAL)
+	{
+		using Function = std::decay_t<F>;
+		using Result   = std::invoke_result_t<Function&>;
+
+		static_assert(!std::is_reference_v<Result>, "Tasks can't return references");
+
+		auto* task = new Task<Result, Function>(std::forward<F>(f));
+		task->retain(); // One reference for the Future, one for the pool
+		push(task, priority);
+		return Future<Result>(task);
+	}
+
+private:
+	static constexpr std::size_t PRIORITIES = 3;
+
+	template <typename T, typename F>
+	class Task final : public TaskState<T>
+	{
+	public:
+		template <typename G>
+		explicit Task(G&& g)
+		: m_function(std::forward<G>(g))
+		{
+		}
+
+		void run() override { this->complete(m_function); }
+
+	private:
+		F m_function;
+	};
+
+	struct Worker;
+
+	void      push(TaskBase*, Priority);
+	TaskBase* findTask(std::size_t index);
+	void      work(std::size_t index);
+
+	std::vector<std::unique_ptr<Worker>>                                     m_workers;
+	std::array<std::unique_ptr<container::MpmcQueue<TaskBase*>>, PRIORITIES> m_queues;
+	std::atomic<std::uint32_t>                                               m_wake{0};
+	std::atomic<std::uint32_t>                                               m_sleeping{0};
+	std::atomic<bool>                                                        m_stopping{false};
+};
+} // namespace mcl::utils::thread
+
+#endif
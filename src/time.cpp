@@ -24,14 +24,360 @@
  *
  * -------------------------------------------------------------------------- */
 
-#include "time.h"
-#include <chrono>
+#include "os.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <thread>
+#if MCL_OS_LINUX || MCL_OS_FREEBSD
+#include <cerrno>
+#include <time.h> // clock_nanosleep
+#endif
+#if MCL_CPU_SSE2
+#include <emmintrin.h> // _mm_pause
+#endif
+#if MCL_CPU_X86 && defined(_MSC_VER)
+#include <intrin.h> // __cpuid, __rdtsc
+#elif MCL_CPU_X86
+#include <cpuid.h>     // __get_cpuid
+#include <x86intrin.h> // __rdtsc
+#endif
+#include "time.hpp"
 
 namespace mcl::utils::time
 {
+namespace
+{
+void cpuRelax_()
+{
+#if MCL_CPU_SSE2
+	_mm_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#else
+	std::this_thread::yield();
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* sleepUntil_
+Blocking wait on the OS clock. std::chrono::steady_clock is CLOCK_MONOTONIC on
+Linux and FreeBSD, so its time points can be passed as they are. */
+
+void sleepUntil_(Clock::time_point deadline)
+{
+#if MCL_OS_LINUX || MCL_OS_FREEBSD
+	const auto     ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+	const timespec ts = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+		;
+#else
+	std::this_thread::sleep_until(deadline);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::uint64_t getSteadyTicks_()
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* hasInvariantTsc_
+Tells whether the TSC ticks at a constant rate regardless of frequency scaling
+and sleep states (CPUID leaf 0x80000007, EDX bit 8). */
+
+bool hasInvariantTsc_()
+{
+#if MCL_CPU_X86 && defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 0x80000000);
+	if (static_cast<unsigned>(regs[0]) < 0x80000007)
+		return false;
+	__cpuid(regs, 0x80000007);
+	return regs[3] & (1 << 8);
+#elif MCL_CPU_X86
+	unsigned eax, ebx, ecx, edx;
+	return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8));
+#else
+	return false;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* useTsc_
+Function-local static, so that it's ready even for timers started during
+static initialization. */
+
+bool useTsc_()
+{
+	static const bool useTsc = hasInvariantTsc_();
+	return useTsc;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* calibrate_
+Returns the length of a tick in nanoseconds, by counting ticks over a short
+steady_clock interval. */
+
+double calibrate_()
+{
+	if (!useTsc_())
+		return 1.0;
+
+	const Clock::time_point start      = Clock::now();
+	const std::uint64_t     startTicks = getTicks();
+	while (Clock::now() - start < std::chrono::milliseconds(5))
+		cpuRelax_();
+	const std::uint64_t ticks   = getTicks() - startTicks;
+	const double        elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	return ticks > 0 ? elapsed / ticks : 1.0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* getNanosecondsPerTick_
+Function-local static, so that calibration happens only once, whether it's
+triggered by calibrate() or by the first conversion. */
+
+double getNanosecondsPerTick_()
+{
+	static const double nanosecondsPerTick = calibrate_();
+	return nanosecondsPerTick;
+}
+} // namespace
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 void sleep(int millisecs)
 {
 	std::this_thread::sleep_for(std::chrono::milliseconds(millisecs));
 }
+
+/* -------------------------------------------------------------------------- */
+
+void sleepUntil(Clock::time_point deadline, std::chrono::nanoseconds spin)
+{
+	const Clock::time_point wakeUp = deadline - spin;
+	if (Clock::now() < wakeUp)
+		sleepUntil_(wakeUp);
+	while (Clock::now() < deadline)
+		cpuRelax_();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void sleepFor(std::chrono::nanoseconds duration, std::chrono::nanoseconds spin)
+{
+	sleepUntil(Clock::now() + duration, spin);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+PeriodicTimer::PeriodicTimer(std::chrono::nanoseconds period, std::chrono::nanoseconds spin)
+: m_period(period)
+, m_spin(spin)
+{
+	reset();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void PeriodicTimer::reset()
+{
+	m_next = Clock::now() + m_period;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::size_t PeriodicTimer::wait()
+{
+	std::size_t             missed = 0;
+	const Clock::time_point now    = Clock::now();
+	if (now >= m_next + m_period && m_period.count() > 0)
+	{
+		missed = static_cast<std::size_t>((now - m_next) / m_period);
+		m_next += missed * m_period;
+	}
+
+	sleepUntil(m_next, m_spin);
+	m_next += m_period;
+	return missed;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+std::uint64_t getTicks()
+{
+#if MCL_CPU_X86
+	if (useTsc_())
+		return __rdtsc();
+#endif
+	return getSteadyTicks_();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void calibrate()
+{
+	getNanosecondsPerTick_();
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::chrono::nanoseconds ticksToNanoseconds(std::uint64_t ticks)
+{
+	return std::chrono::nanoseconds(static_cast<std::int64_t>(ticks * getNanosecondsPerTick_()));
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+Stopwatch::Stopwatch()
+: m_start(getTicks())
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Stopwatch::reset()
+{
+	m_start = getTicks();
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::uint64_t Stopwatch::getElapsedTicks() const
+{
+	return getTicks() - m_start;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::chrono::nanoseconds Stopwatch::getElapsed() const
+{
+	return ticksToNanoseconds(getElapsedTicks());
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+std::size_t LatencyHistogram::getBucket(std::uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+		return static_cast<std::size_t>(value);
+	const int shift = std::bit_width(value) - (SUB_BUCKET_BITS + 1); // value >> shift is in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+	return (shift + 1) * SUB_BUCKETS + static_cast<std::size_t>((value >> shift) - SUB_BUCKETS);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* getBucketValue
+Returns the highest value that falls into 'bucket', so that percentiles are
+never underestimated. */
+
+std::uint64_t LatencyHistogram::getBucketValue(std::size_t bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return bucket;
+	const std::size_t   shift = bucket / SUB_BUCKETS - 1;
+	const std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+	return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration)
+{
+	const std::uint64_t value = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+
+	m_counts[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+
+	std::uint64_t max = m_max.load(std::memory_order_relaxed);
+	while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+		;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::chrono::nanoseconds LatencyHistogram::getPercentile(double p) const
+{
+	const std::uint64_t count = getCount();
+	if (count == 0)
+		return std::chrono::nanoseconds(0);
+
+	const std::uint64_t target = std::clamp<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(p / 100.0 * count)), 1, count);
+	const std::uint64_t max    = m_max.load(std::memory_order_relaxed);
+
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < BUCKETS; i++)
+	{
+		seen += m_counts[i].load(std::memory_order_relaxed);
+		if (seen >= target)
+			return std::chrono::nanoseconds(std::min(getBucketValue(i), max));
+	}
+	return std::chrono::nanoseconds(max);
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::uint64_t LatencyHistogram::getCount() const
+{
+	std::uint64_t count = 0;
+	for (const std::atomic<std::uint64_t>& c : m_counts)
+		count += c.load(std::memory_order_relaxed);
+	return count;
+}
+
+/* -------------------------------------------------------------------------- */
+
+std::chrono::nanoseconds LatencyHistogram::getMax() const
+{
+	return std::chrono::nanoseconds(m_max.load(std::memory_order_relaxed));
+}
+
+/* -------------------------------------------------------------------------- */
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const
+{
+	return {getCount(), getPercentile(50), getPercentile(99), getPercentile(99.9), getMax()};
+}
+
+/* -------------------------------------------------------------------------- */
+
+void LatencyHistogram::reset()
+{
+	for (std::atomic<std::uint64_t>& c : m_counts)
+		c.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+ScopedTimer::ScopedTimer(LatencyHistogram& histogram)
+: m_histogram(histogram)
+{
+}
+
+/* -------------------------------------------------------------------------- */
+
+ScopedTimer::~ScopedTimer()
+{
+	m_histogram.record(m_stopwatch.getElapsed());
+}
 } // namespace mcl::utils::time
@@ -27,8 +27,172 @@
 #ifndef MONOCASUAL_UTILS_TIME_H
 #define MONOCASUAL_UTILS_TIME_H
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
 namespace mcl::utils::time
 {
+/* Clock
+Monotonic clock used for deadlines. Maps to CLOCK_MONOTONIC on POSIX. */
+
+using Clock = std::chrono::steady_clock;
+
 void sleep(int millisecs);
-}
-#endif
\ No newline at end of file
+
+/* sleepUntil
+Sleeps until 'deadline', with an absolute wait so that the time spent before
+the call doesn't count. The OS usually wakes the thread up a few tens of
+microseconds late: the last 'spin' of the wait can be busy-waited instead, to
+trade CPU time for precision. */
+
+void sleepUntil(Clock::time_point deadline, std::chrono::nanoseconds spin = std::chrono::nanoseconds(0));
+
+/* sleepFor
+Like sleepUntil, relative to now. */
+
+void sleepFor(std::chrono::nanoseconds duration, std::chrono::nanoseconds spin = std::chrono::nanoseconds(0));
+
+/* -------------------------------------------------------------------------- */
+
+/* PeriodicTimer
+Paces a loop at a fixed rate. Deadlines are computed as start + n * period,
+so wake-up latency never accumulates into drift. */
+
+class PeriodicTimer
+{
+public:
+	explicit PeriodicTimer(std::chrono::nanoseconds period, std::chrono::nanoseconds spin = std::chrono::nanoseconds(0));
+
+	/* wait
+	Sleeps until the next tick. If the caller fell behind by whole periods,
+	the missed ticks are skipped rather than fired in a burst: returns how many. */
+
+	std::size_t wait();
+
+	/* reset
+	Restarts the schedule from now. */
+
+	void reset();
+
+	Clock::time_point getNextDeadline() const { return m_next; }
+
+private:
+	std::chrono::nanoseconds m_period;
+	std::chrono::nanoseconds m_spin;
+	Clock::time_point        m_next;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* getTicks
+Raw timestamp for measuring short intervals. Reads the CPU time-stamp counter
+where it runs at a constant rate (invariant TSC on x86), steady_clock
+otherwise. Convert differences with ticksToNanoseconds(). */
+
+std::uint64_t getTicks();
+
+/* calibrate
+Measures the TSC rate against steady_clock, busy-waiting for a few
+milliseconds. Call it once at startup from a non real-time thread, otherwise
+the first ticksToNanoseconds() call does it. Subsequent calls are no-ops. */
+
+void calibrate();
+
+/* ticksToNanoseconds
+Converts a tick difference. Never blocks once calibrate() has been called. */
+
+std::chrono::nanoseconds ticksToNanoseconds(std::uint64_t ticks);
+
+/* -------------------------------------------------------------------------- */
+
+class Stopwatch
+{
+public:
+	Stopwatch();
+
+	void reset();
+
+	std::uint64_t            getElapsedTicks() const;
+	std::chrono::nanoseconds getElapsed() const;
+
+private:
+	std::uint64_t m_start;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* LatencyHistogram
+Lock-free histogram of durations, with HDR-style logarithmic buckets: values
+are grouped by power of two, each group split into 32 linear sub-buckets, so
+reported values are within ~3% of the recorded ones over the whole range.
+record() can be called from any number of threads, including real-time ones:
+it never blocks nor allocates. It costs an atomic increment on a shared
+counter, plus a compare-and-swap on a new maximum: tens of nanoseconds rather
+than a few, more when many threads record into the same histogram at once (use
+one per thread then). Reads are not a consistent snapshot while recording is in
+progress, which is fine for monitoring. */
+
+class LatencyHistogram
+{
+public:
+	struct Summary
+	{
+		std::uint64_t            count = 0;
+		std::chrono::nanoseconds p50{0};
+		std::chrono::nanoseconds p99{0};
+		std::chrono::nanoseconds p999{0};
+		std::chrono::nanoseconds max{0};
+	};
+
+	LatencyHistogram() = default;
+
+	void record(std::chrono::nanoseconds);
+
+	/* getPercentile
+	Returns the value below which 'p' percent (0-100) of the records fall. */
+
+	std::chrono::nanoseconds getPercentile(double p) const;
+
+	std::uint64_t            getCount() const;
+	std::chrono::nanoseconds getMax() const;
+	Summary                  getSummary() const;
+
+	void reset();
+
+private:
+	static constexpr int         SUB_BUCKET_BITS = 5;
+	static constexpr std::size_t SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+	static constexpr std::size_t BUCKETS         = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	static std::size_t   getBucket(std::uint64_t value);
+	static std::uint64_t getBucketValue(std::size_t bucket);
+
+	std::array<std::atomic<std::uint64_t>, BUCKETS> m_counts{};
+	std::atomic<std::uint64_t>                      m_max{0};
+};
+
+/* -------------------------------------------------------------------------- */
+
+/* ScopedTimer
+Records the lifetime of the object into a LatencyHistogram. Call calibrate()
+at startup before using it on the audio thread, otherwise the first destructor
+stalls for a few milliseconds. */
+
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(LatencyHistogram&);
+	ScopedTimer(const ScopedTimer&)            = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+	~ScopedTimer();
+
+private:
+	LatencyHistogram& m_histogram;
+	Stopwatch         m_stopwatch;
+};
+} // namespace mcl::utils::time
+
+#endif
@@ -1,10 +1,28 @@
 #include "src/container.hpp"
 #include "src/fs.hpp"
 #include "src/id.hpp"
+#include "src/log.hpp"
 #include "src/math.hpp"
+#include "src/memory.hpp"
+#include "src/os.hpp"
 #include "src/string.hpp"
+#include "src/thread.hpp"
+#include "src/time.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#if defined(__linux__)
+#include <sched.h> // sched_getcpu
+#endif
 
 TEST_CASE("fs")
 {
@@ -17,6 +35,7 @@ TEST_CASE("fs")
 	REQUIRE(dirname("tests/utils.cpp") == "tests");
 	REQUIRE(getExt("tests/utils.cpp") == ".cpp");
 	REQUIRE(stripExt("tests/utils.cpp") == "tests/utils");
+	REQUIRE(uriToPath("file:///home/my%20samples/kick.wav") == "/home/my samples/kick.wav");
 #if defined(_WIN32)
 	REQUIRE(isRootDir("C:\\path\\to\\something") == false);
 	REQUIRE(getUpDir("C:\\path\\to\\something") == "C:\\path\\to");
@@ -28,6 +47,284 @@ TEST_CASE("fs")
 	REQUIRE(getUpDir("/path") == "/");
 	REQUIRE(getUpDir("/") == "/");
 #endif
+
+	SECTION("path views")
+	{
+		namespace stdfs = std::filesystem;
+
+		REQUIRE(basenameView("tests/utils.cpp") == "utils.cpp");
+		REQUIRE(dirnameView("tests/utils.cpp") == dirname("tests/utils.cpp"));
+		REQUIRE(getExtView("tests/utils.cpp") == getExt("tests/utils.cpp"));
+		REQUIRE(getStemView("tests/utils.cpp") == "utils");
+		REQUIRE(stripExtView("tests/utils.cpp") == stripExt("tests/utils.cpp"));
+#if defined(_WIN32)
+		REQUIRE(dirnameView("C:\\path\\to\\something") == getUpDir("C:\\path\\to\\something"));
+		REQUIRE(dirnameView("C:\\path") == getUpDir("C:\\path"));
+#else
+		REQUIRE(dirnameView("/path/to/something") == getUpDir("/path/to/something"));
+		REQUIRE(dirnameView("/path") == getUpDir("/path"));
+		REQUIRE(dirnameView("/") == getUpDir("/"));
+#endif
+
+		for (const std::string p : {"", "/", "a", "a/", "a/b", "a//b", "/a", "/a/b/", "a/b.c", ".bashrc", "a/.bashrc",
+		         "a/b.", "a/..", "a/.", "a/b.c.d", "..", ".", "a/.x.y", "/a//", "a///b//"})
+		{
+			INFO(p);
+			REQUIRE(basenameView(p) == stdfs::path(p).filename().string());
+			REQUIRE(dirnameView(p) == stdfs::path(p).parent_path().string());
+			REQUIRE(getExtView(p) == stdfs::path(p).extension().string());
+			REQUIRE(getStemView(p) == stdfs::path(p).stem().string());
+			REQUIRE(stripExtView(p) == stdfs::path(p).replace_extension("").string());
+		}
+
+		char buffer[64];
+		REQUIRE(join("a", "b", buffer) == join("a", "b"));
+		REQUIRE(join("a/", "b", buffer) == join("a/", "b"));
+		REQUIRE(join("", "b", buffer) == join("", "b"));
+		REQUIRE(join("a", "", buffer) == join("a", ""));
+		REQUIRE(join("a", "/b", buffer) == join("a", "/b"));
+		REQUIRE(join("/path/to", "file.txt", std::span<char>(buffer, 4)).empty());
+	}
+
+	SECTION("scan")
+	{
+		namespace stdfs = std::filesystem;
+
+		const stdfs::path root = stdfs::temp_directory_path() / "mcl-utils-scan-test";
+		stdfs::remove_all(root);
+		for (int i = 0; i < 20; i++)
+		{
+			const stdfs::path dir = root / ("dir" + std::to_string(i)) / "sub";
+			stdfs::create_directories(dir);
+			std::ofstream(dir / "kick.wav");
+			std::ofstream(dir / "SNARE.WAV");
+			std::ofstream(dir / "notes.txt");
+		}
+		std::ofstream(root / "loop.flac");
+
+		std::vector<std::string> files;
+		std::size_t              maxBatchSize = 0;
+
+		const ScanOptions options = {.extensions = {".wav", ".flac"}, .threads = 4, .batchSize = 7};
+		const std::size_t count   = scan(root.string(), options, [&](std::span<const std::string> batch) {
+			files.insert(files.end(), batch.begin(), batch.end());
+			maxBatchSize = std::max(maxBatchSize, batch.size());
+		});
+
+		REQUIRE(count == 41);
+		REQUIRE(maxBatchSize <= 7);
+		REQUIRE(files.size() == 41);
+		REQUIRE(std::ranges::count_if(files, [](const std::string& f) { return f.ends_with(".txt"); }) == 0);
+
+		REQUIRE(scan(root.string(), {}, [](std::span<const std::string>) {}) == 61);
+		REQUIRE(scan((root / "nonexistent").string(), {}, [](std::span<const std::string>) {}) == 0);
+
+		// a symlink loop is skipped by default and visited once when following symlinks
+		stdfs::create_directory_symlink(root, root / "dir0" / "loop");
+		REQUIRE(scan(root.string(), {}, [](std::span<const std::string>) {}) == 61);
+		REQUIRE(scan(root.string(), {.extensions = {}, .followSymlinks = true}, [](std::span<const std::string>) {}) == 61);
+
+		stdfs::remove_all(root);
+	}
+
+	SECTION("MappedFile")
+	{
+		const std::string path    = (std::filesystem::temp_directory_path() / "mcl-utils-mapped-file-test").string();
+		const std::string content = "Monocasual Utils\n";
+		std::ofstream(path, std::ios::binary) << content;
+
+		MappedFile file(path, MappedFile::Hint::SEQUENTIAL);
+		REQUIRE(file.isOpen());
+		REQUIRE(file.getView() == content);
+		REQUIRE(file.getBytes().size() == content.size());
+		file.advise(MappedFile::Hint::RANDOM);
+
+		MappedFile moved = std::move(file);
+		REQUIRE(!file.isOpen());
+		REQUIRE(moved.getView() == content);
+
+		std::ofstream(path, std::ios::binary | std::ios::trunc);
+		REQUIRE(MappedFile(path).isOpen());
+		REQUIRE(MappedFile(path).getSize() == 0);
+		REQUIRE(!MappedFile("nonexistent_file").isOpen());
+
+#if defined(__linux__)
+		MappedFile virtualFile("/proc/self/status"); // Reports size 0: falls back to buffered reads
+		REQUIRE(virtualFile.isOpen());
+		REQUIRE(!virtualFile.isMapped());
+		REQUIRE(virtualFile.getSize() > 0);
+#endif
+
+		std::filesystem::remove(path);
+	}
+
+	SECTION("MetadataCache")
+	{
+		namespace stdfs = std::filesystem;
+
+		const stdfs::path root = stdfs::temp_directory_path() / "mcl-utils-metadata-cache-test";
+		const std::string file = (root / "file.txt").string();
+		stdfs::remove_all(root);
+		stdfs::create_directories(root);
+
+		MetadataCache cache(std::chrono::milliseconds(20));
+
+		REQUIRE(cache.isDir(root.string()));
+		REQUIRE(cache.dirExists(root.string()));
+		REQUIRE(!cache.fileExists(file));
+		REQUIRE(!cache.fileExists(file));
+		REQUIRE(cache.getStats().misses == 2);
+		REQUIRE(cache.getStats().hits == 2);
+		REQUIRE(cache.getRealPath("nonexistent_file") == "");
+
+		/* Not watched: stale until the TTL expires. */
+
+		std::ofstream(file) << "";
+		REQUIRE(!cache.fileExists(file));
+		std::this_thread::sleep_for(std::chrono::milliseconds(40));
+		REQUIRE(cache.fileExists(file));
+		REQUIRE(cache.getRealPath(file) == stdfs::canonical(file).string());
+
+		cache.invalidate(root.string());
+		REQUIRE(cache.getStats().invalidations >= 2);
+
+		/* Only the path itself and what's below it are dropped. */
+
+		MetadataCache     cached(std::chrono::hours(1));
+		const std::string sub = (root / "sub").string();
+		for (const std::string& p : {sub, sub + "/a", sub + "/b/c", sub + "2", sub + "2/a", sub + ".txt"})
+			cached.fileExists(p);
+		cached.invalidate(sub);
+		REQUIRE(cached.getStats().invalidations == 3);
+		cached.fileExists(sub + "2/a");
+		cached.fileExists(sub + ".txt");
+		REQUIRE(cached.getStats().hits == 2);
+
+#if defined(__linux__)
+		MetadataCache watched(std::chrono::hours(1));
+		REQUIRE(watched.watch(root.string() + "/"));
+		REQUIRE(watched.fileExists(file));
+
+		stdfs::remove(file);
+		bool updated = false;
+		for (int i = 0; i < 200 && !updated; i++) // Events are delivered asynchronously
+		{
+			updated = !watched.fileExists(file);
+			if (!updated)
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		REQUIRE(updated);
+		REQUIRE(watched.getStats().invalidations >= 1);
+#endif
+
+		stdfs::remove_all(root);
+	}
+
+	SECTION("AsyncReader")
+	{
+		namespace stdfs = std::filesystem;
+
+		const stdfs::path root = stdfs::temp_directory_path() / "mcl-utils-async-reader-test";
+		stdfs::remove_all(root);
+		stdfs::create_directories(root);
+
+		std::vector<std::string>                     paths;
+		std::unordered_map<std::string, std::string> contents;
+		for (std::size_t i = 0; i < 32; i++)
+		{
+			const std::string path = (root / ("file" + std::to_string(i))).string();
+			const std::string data(i * i * 1024, static_cast<char>('a' + i % 26)); // Up to ~1 MiB, first one empty
+			std::ofstream(path, std::ios::binary) << data;
+			paths.push_back(path);
+			contents[path] = data;
+		}
+
+		for (const bool preferIoUring : {false, true})
+		{
+			AsyncReader reader({.preferIoUring = preferIoUring, .threads = 3, .queueDepth = 4, .maxInFlightBytes = 512 * 1024});
+
+			std::mutex                                   mutex;
+			std::unordered_map<std::string, std::string> results;
+			std::size_t                                  errors = 0;
+			reader.read(paths, [&](AsyncReader::Result& result) {
+				std::scoped_lock lock(mutex);
+				errors += result.error ? 1 : 0;
+				results[result.path] = std::string(reinterpret_cast<const char*>(result.data.data()), result.data.size());
+			});
+			reader.wait();
+
+			REQUIRE(errors == 0);
+			REQUIRE(results == contents);
+
+			std::vector<std::byte> buffer(2048);
+			std::error_code        error;
+			reader.read(paths[1], buffer, [&error](AsyncReader::Result& result) { error = result.error; });
+			reader.wait();
+			REQUIRE(!error);
+			reader.read(paths[2], buffer, [&error](AsyncReader::Result& result) { error = result.error; });
+			reader.wait();
+			REQUIRE(error == std::errc::value_too_large);
+
+			AsyncReader::Result result = reader.read(paths[31]).get();
+			REQUIRE(result.buffer.size() == contents[paths[31]].size());
+			REQUIRE(result.data.data() == result.buffer.data());
+			REQUIRE(reader.read("nonexistent_file").get().error);
+
+#if defined(__linux__)
+			REQUIRE(reader.read("/proc/self/status").get().data.size() > 0); // Reports size 0
+#endif
+		}
+
+		stdfs::remove_all(root);
+	}
+
+	SECTION("AtomicWriter")
+	{
+		namespace stdfs = std::filesystem;
+
+		const stdfs::path root = stdfs::temp_directory_path() / "mcl-utils-atomic-writer-test";
+		const std::string path = (root / "project.json").string();
+		stdfs::remove_all(root);
+		stdfs::create_directories(root);
+
+		const auto readAll = [](const std::string& p) {
+			std::ifstream stream(p, std::ios::binary);
+			return std::string(std::istreambuf_iterator<char>(stream), {});
+		};
+
+		std::ofstream(path, std::ios::binary) << "old";
+
+		std::string expected;
+		{
+			AtomicWriter writer(path, {.bufferSize = 100, .preallocate = 1024 * 1024});
+			REQUIRE(writer.isOpen());
+			for (int i = 0; i < 1000; i++) // Mix of buffered and direct writes
+			{
+				const std::string chunk(i % 7 == 0 ? 5000 : i % 50, static_cast<char>('a' + i % 26));
+				REQUIRE(writer.write(chunk));
+				expected += chunk;
+			}
+			REQUIRE(readAll(path) == "old");
+			REQUIRE(writer.commit());
+			REQUIRE(!writer.getError());
+		}
+		REQUIRE(readAll(path) == expected);
+
+		{
+			AtomicWriter writer(path, {.durable = false});
+			REQUIRE(writer.write("discarded"));
+		}
+		REQUIRE(readAll(path) == expected);
+		REQUIRE(std::distance(stdfs::directory_iterator(root), stdfs::directory_iterator()) == 1); // No temp files left
+
+		AtomicWriter failing((root / "missing" / "file").string());
+		REQUIRE(!failing.isOpen());
+		REQUIRE(failing.getError());
+		REQUIRE(!failing.write("data"));
+		REQUIRE(!failing.commit());
+
+		stdfs::remove_all(root);
+	}
 }
 
 TEST_CASE("string")
@@ -35,6 +332,33 @@ TEST_CASE("string")
 	using namespace mcl::utils::string;
 
 	REQUIRE(replace("This is cool", "cool", "hot") == "This is hot");
+	REQUIRE(replace("aaa", "a", "bb") == "bbbbbb");
+	REQUIRE(replace("a--b--c", "--", "") == "abc");
+	REQUIRE(replace("aaaa", "aa", "b") == "bb");
+	REQUIRE(replace("abcabc", "bc", "xy") == "axyaxy");
+	REQUIRE(replace("abc", "", "x") == "abc");
+	REQUIRE(replace("abc", "d", "x") == "abc");
+
+	SECTION("Replacer, replaceAll")
+	{
+		REQUIRE(replaceAll("file:///my%20sample.wav", {{"file://", ""}, {"%20", " "}}) == "/my sample.wav");
+		REQUIRE(replaceAll("she sells sea shells", {{"he", "HE"}, {"she", "SHE"}, {"hers", "HERS"}, {"s", "$"}}) == "SHE $ell$ $ea SHEll$");
+		REQUIRE(replaceAll("abcd", {{"abcd", "1"}, {"bc", "2"}}) == "1");         // Leftmost wins, even if it ends later
+		REQUIRE(replaceAll("abcx", {{"abcd", "1"}, {"bc", "2"}}) == "a2x");       // Falls back to the shorter one
+		REQUIRE(replaceAll("aaab", {{"a", "1"}, {"aab", "2"}}) == "12");          // Text after a match is scanned again
+		REQUIRE(replaceAll("cb", {{"c", "1"}, {"cba", "2"}, {"b", "3"}}) == "13");  // Also at the end of the input
+		REQUIRE(replaceAll("hershe", {{"he", "2"}, {"hers", "4"}, {"s", "1"}}) == "42"); // Longest on ties
+		REQUIRE(replaceAll("abab", {{"ab", "ba"}}) == "baba");             // Replacements are not scanned again
+		REQUIRE(replaceAll("abc", {{"", "x"}, {"b", "B"}, {"b", "?"}}) == "aBc");
+		REQUIRE(replaceAll("", {{"a", "b"}}).empty());
+		REQUIRE(replaceAll("abc", {}) == "abc");
+
+		/* Same result as chained replace() calls, when patterns don't interact. */
+
+		const Replacer    replacer({{"%20", " "}, {"%2F", "/"}, {"&amp;", "&"}});
+		const std::string in = "a%20b%2Fc&amp;d%20%20e&amp";
+		REQUIRE(replacer.apply(in) == replace(replace(replace(in, "%20", " "), "%2F", "/"), "&amp;", "&"));
+	}
 	REQUIRE(trim("   This is cool       ") == "This is cool");
 
 	std::vector<std::string> v = split("This is cool", " ");
@@ -42,6 +366,72 @@ TEST_CASE("string")
 	REQUIRE(v.at(0) == "This");
 	REQUIRE(v.at(1) == "is");
 	REQUIRE(v.at(2) == "cool");
+
+	const auto views = split<mcl::utils::container::SmallVector<std::string_view, 4>>("This is cool", " ");
+	REQUIRE(views.isInline());
+	REQUIRE(views.size() == 3);
+	REQUIRE(views[2] == "cool");
+
+	SECTION("splitView")
+	{
+		static_assert(std::ranges::forward_range<SplitView>);
+
+		const std::string_view        in = ",,This is;;cool, ";
+		std::vector<std::string_view> tokens;
+		for (std::string_view token : splitView(in, ",; "))
+			tokens.push_back(token);
+		REQUIRE(tokens == std::vector<std::string_view>{"This", "is", "cool"});
+		REQUIRE(tokens.size() == split(std::string(in), ",; ").size());
+
+		std::size_t count = 0;
+		splitView(in, ",; ", [&count](std::string_view) { count++; });
+		REQUIRE(count == 3);
+
+		REQUIRE(std::ranges::empty(splitView("", " ")));
+		REQUIRE(std::ranges::empty(splitView("   ", " ")));
+	}
+
+	SECTION("toFloat, toInt")
+	{
+		REQUIRE(toFloat("3.5") == 3.5f);
+		REQUIRE(toFloat("  -0.25xyz") == -0.25f);
+		REQUIRE(toFloat("+2") == 2.0f);
+		REQUIRE(toFloat("garbage") == 0.0f);
+		REQUIRE(toFloat("") == 0.0f);
+		REQUIRE(toInt("42") == 42);
+		REQUIRE(toInt(" -7 ") == -7);
+		REQUIRE(toInt("12abc") == 12);
+		REQUIRE(toInt("99999999999999999999") == 0);
+		REQUIRE(toInt("abc") == 0);
+	}
+
+	SECTION("parseFloat, parseInt")
+	{
+		REQUIRE(parseFloat(" 1.5 ") == 1.5f);
+		REQUIRE(parseFloat("1.5x") == std::nullopt);
+		REQUIRE(parseFloat("") == std::nullopt);
+		REQUIRE(parseInt("-12") == -12);
+		REQUIRE(parseInt("12abc") == std::nullopt);
+		REQUIRE(parseInt("99999999999999999999") == std::nullopt);
+	}
+
+	SECTION("parseFloats, parseInts")
+	{
+		std::vector<float> floats(8);
+		ParseResult        res = parseFloats("1.5;;-2;oops;+4.25;", ";", floats, -1.0f);
+		REQUIRE(res.count == 4);
+		REQUIRE(res.errors == 1);
+		REQUIRE(floats[0] == 1.5f);
+		REQUIRE(floats[1] == -2.0f);
+		REQUIRE(floats[2] == -1.0f);
+		REQUIRE(floats[3] == 4.25f);
+
+		std::vector<int> ints(2);
+		res = parseInts("1 2 3", " ", ints);
+		REQUIRE(res.count == 2);
+		REQUIRE(res.errors == 0);
+		REQUIRE(ints == std::vector<int>{1, 2});
+	}
 }
 
 TEST_CASE("math")
@@ -55,6 +445,74 @@ TEST_CASE("math")
 	REQUIRE(map(0.0f, 30.0f, 1.0f) == 0.0f);
 	REQUIRE(map(30.0f, 30.0f, 1.0f) == 1.0f);
 	REQUIRE_THAT(map(15.0f, 30.0f, 1.0f), Catch::Matchers::WithinAbs(0.5f, 0.001f));
+
+	SECTION("Mapper")
+	{
+		constexpr Mapper<float, float> mapper(0.0f, 30.0f, 0.0f, 1.0f);
+		static_assert(mapper(0.0f) == 0.0f);
+
+		REQUIRE_THAT(mapper(15.0f), Catch::Matchers::WithinAbs(0.5f, 0.001f));
+		REQUIRE_THAT(mapper(30.0f), Catch::Matchers::WithinAbs(1.0f, 0.00001f));
+		REQUIRE(Mapper<int, int>(0, 100, 0, 10)(50) == map(50, 0, 100, 0, 10));
+		REQUIRE(Mapper<int, int>(0, 7, 0, 61)(7) == 61);
+
+		/* Integer results are truncated: Mapper must agree with map() on every
+		input, endpoints included. */
+
+		bool same = true;
+		for (int b = 1; b < 40; b++)
+			for (int z = 1; z < 80; z += 3)
+				for (const auto& [a, w] : {std::pair{0, 0}, std::pair{-5, 3}, std::pair{7, -11}})
+				{
+					const Mapper<int, int>   ints(a, a + b, w, w + z);
+					const Mapper<float, int> floats(static_cast<float>(a), static_cast<float>(a + b), w, w + z);
+					for (int x = a; x <= a + b; x++)
+					{
+						same &= ints(x) == map(x, a, a + b, w, w + z);
+						same &= floats(static_cast<float>(x)) == map(static_cast<float>(x), static_cast<float>(a), static_cast<float>(a + b), w, w + z);
+					}
+				}
+		REQUIRE(same);
+
+		std::vector<int> ints = {0, 3, 7};
+		Mapper<int, int>(0, 7, 0, 61).apply(ints);
+		REQUIRE(ints == std::vector<int>{0, map(3, 0, 7, 0, 61), 61});
+		REQUIRE(Mapper<float, float>(5.0f, 5.0f, 0.0f, 1.0f)(3.0f) == map(3.0f, 5.0f, 5.0f, 0.0f, 1.0f));
+		const Mapper<int, float> toFloat(0, 7, 0.0f, 61.0f); // Not truncated: scale and offset only
+		REQUIRE_THAT(toFloat(3), Catch::Matchers::WithinAbs(map(3, 0, 7, 0.0f, 61.0f), 0.00001f));
+		static_assert(sizeof(toFloat) == 2 * sizeof(double));
+
+		std::vector<float> values = {0.0f, 7.5f, 15.0f, 22.5f, 30.0f, 10.0f, 20.0f, 3.0f, 1.0f};
+		std::vector<float> out(values.size());
+		mapper.apply(values, out);
+		for (std::size_t i = 0; i < values.size(); i++)
+			REQUIRE_THAT(out[i], Catch::Matchers::WithinAbs(map(values[i], 0.0f, 30.0f, 0.0f, 1.0f), 0.00001f));
+
+		mapper.apply(values);
+		REQUIRE(values == out);
+	}
+
+	SECTION("linearToDB, dBtoLinear (block)")
+	{
+		const std::vector<float> linear = {0.001f, 0.01f, 0.1f, 0.25f, 0.5f, 0.707f, 1.0f, 1.5f, 2.0f, 4.0f, 1e-20f, 1e20f, 3e-40f};
+		const std::vector<float> dB     = {-120.0f, -60.0f, -6.0f, -0.5f, 0.0f, 0.5f, 6.0f, 12.0f, 24.0f};
+
+		std::vector<float> out(linear.size());
+		linearToDB(linear, out);
+		for (std::size_t i = 0; i < linear.size(); i++)
+			REQUIRE_THAT(out[i], Catch::Matchers::WithinAbs(linearToDB(linear[i]), 0.001f));
+
+		out.resize(dB.size());
+		dBtoLinear(dB, out);
+		for (std::size_t i = 0; i < dB.size(); i++)
+			REQUIRE_THAT(out[i], Catch::Matchers::WithinRel(dBtoLinear(dB[i]), 0.00001f));
+
+		const std::vector<float> special = {0.0f, -1.0f};
+		out.resize(special.size());
+		linearToDB(special, out);
+		REQUIRE(out[0] == -std::numeric_limits<float>::infinity());
+		REQUIRE(std::isnan(out[1]));
+	}
 }
 
 TEST_CASE("id")
@@ -72,6 +530,102 @@ TEST_CASE("id")
 	REQUIRE(++valid == Id{2});
 	REQUIRE(valid++ == Id{2});
 	REQUIRE(valid == Id{3});
+
+	SECTION("IdGenerator")
+	{
+		IdGenerator generator(/*blockSize=*/16);
+
+		std::vector<std::vector<Id>> ids(4);
+		std::vector<std::thread>     threads;
+		for (std::vector<Id>& v : ids)
+			threads.emplace_back([&generator, &v]() {
+				for (int i = 0; i < 1000; i++)
+					v.push_back(generator.generate());
+			});
+		for (std::thread& t : threads)
+			t.join();
+
+		std::set<Id> unique;
+		for (const std::vector<Id>& v : ids)
+			unique.insert(v.begin(), v.end());
+		REQUIRE(unique.size() == 4000);
+		REQUIRE(unique.begin()->isValid());
+
+		generator.reseed(Id{100000});
+		Id fromOtherThread;
+		std::thread([&generator, &fromOtherThread]() { fromOtherThread = generator.generate(); }).join();
+		REQUIRE(generator.generate() > Id{100000});
+		REQUIRE(fromOtherThread > Id{100000});
+
+		// Reseeding with a lower value must not hand out the same Ids again
+		const std::size_t before = unique.size();
+		unique.insert(fromOtherThread);
+		for (int i = 0; i < 3000; i++)
+			unique.insert(generator.generate());
+		generator.reseed(Id{1});
+		for (int i = 0; i < 3000; i++)
+			unique.insert(generator.generate());
+		REQUIRE(unique.size() == before + 6001);
+	}
+}
+
+TEST_CASE("log")
+{
+	using namespace mcl::utils;
+
+	std::vector<std::string> messages;
+
+	log::stop();
+	log::setSink([&messages](log::Level, std::string_view s) { messages.emplace_back(s); });
+
+	ML_INFO("value " << 42 << " " << 0.5f << " " << true << " " << Id{3} << "\n");
+	log::flush();
+
+	REQUIRE(messages.size() == 1);
+	REQUIRE(messages[0].ends_with("() - value 42 0.5 true 3"));
+
+	SECTION("dropped messages")
+	{
+		const std::size_t dropped = log::getDroppedCount();
+		for (std::size_t i = 0; i < MCL_LOG_BUFFER_SIZE + 10; i++)
+			ML_INFO("message " << i);
+		REQUIRE(log::getDroppedCount() == dropped + 10);
+
+		log::flush();
+		REQUIRE(messages.size() == MCL_LOG_BUFFER_SIZE + 2); // + 'dropped' warning
+	}
+
+	SECTION("runtime level")
+	{
+		log::setLevel(log::Level::ERROR);
+		ML_INFO("filtered");
+		log::flush();
+		REQUIRE(messages.size() == 1);
+		log::setLevel(log::Level::DEBUG);
+	}
+
+	SECTION("sink that logs")
+	{
+		/* The drain thread logs its first message from within the sink, which
+		registers its buffer while a flush is in progress. */
+
+		std::atomic<bool> pong = false;
+		log::setSink([&](log::Level, std::string_view s) {
+			if (s.ends_with("ping"))
+				ML_INFO("pong");
+			else if (s.ends_with("pong"))
+				pong = true;
+		});
+		log::start();
+		ML_INFO("ping");
+		for (int i = 0; i < 200 && !pong; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		REQUIRE(pong);
+		log::stop();
+	}
+
+	log::setSink({});
+	log::start();
 }
 
 TEST_CASE("container")
@@ -85,4 +639,722 @@ TEST_CASE("container")
 		REQUIRE(indexOf(vec, 1) == 0);
 		REQUIRE(indexOf(vec, 4) == vec.size());
 	}
-}
\ No newline at end of file
+
+	SECTION("indexOf, has, hasIf on numbers")
+	{
+		/* Every length and position, to cover both the vector loops and the
+		scalar tail. */
+
+		const auto check = [](auto zero, auto one) {
+			using T = decltype(zero);
+			bool ok = true;
+			for (std::size_t size = 0; size < 140; size++)
+			{
+				std::vector<T> v(size, zero);
+				ok &= indexOf(v, one) == size && !has(v, one) && !hasIf(v, [one](T t) { return t == one; }) &&
+				      !hasIfBlockwise(v, [one](T t) { return t == one; });
+				for (std::size_t pos = 0; pos < size; pos++)
+				{
+					v[pos] = one;
+					ok &= indexOf(v, one) == pos;
+					if (pos + 1 < size)
+						v[pos + 1] = one; // First match wins
+					ok &= indexOf(v, one) == pos && has(std::span<const T>(v), one) && hasIf(v, [one](T t) { return t == one; }) &&
+					      hasIfBlockwise(v, [one](T t) { return t == one; });
+					std::fill(v.begin(), v.end(), zero);
+				}
+			}
+			return ok;
+		};
+		REQUIRE(check(std::int8_t{0}, std::int8_t{-1}));
+		REQUIRE(check(std::uint16_t{0}, std::uint16_t{0xFF00}));
+		REQUIRE(check(0, 1));
+		REQUIRE(check(std::int64_t{0x100000000}, std::int64_t{0})); // Lower halves are equal
+		REQUIRE(check(0.0f, 1.0f));
+		REQUIRE(check(0.0, -1.0));
+		REQUIRE(check(mcl::utils::Id{1}, mcl::utils::Id{2}));
+
+		const std::vector<float> floats = {1.0f, std::nanf(""), -0.0f};
+		REQUIRE(indexOf(floats, 0.0f) == 2);
+		REQUIRE(indexOf(floats, std::nanf("")) == 3);
+
+		std::vector<int> ints(100, 0);
+		std::size_t      calls = 0;
+		ints[10]               = 1;
+		REQUIRE(hasIf(ints, [&calls](int i) {
+			calls++;
+			return i == 1;
+		}));
+		REQUIRE(calls == 11); // Stops at the first match
+	}
+
+	SECTION("sortedIndexOf, sortedHas")
+	{
+		const std::vector<int> sorted = {1, 3, 3, 3, 7, 9, 12};
+		REQUIRE(sortedIndexOf(sorted, 1) == 0);
+		REQUIRE(sortedIndexOf(sorted, 3) == 1);
+		REQUIRE(sortedIndexOf(sorted, 12) == 6);
+		REQUIRE(sortedIndexOf(sorted, 0) == sorted.size());
+		REQUIRE(sortedIndexOf(sorted, 4) == sorted.size());
+		REQUIRE(sortedIndexOf(sorted, 13) == sorted.size());
+		REQUIRE(sortedIndexOf(std::vector<int>{}, 1) == 0);
+		REQUIRE(sortedHas(sorted, 9));
+		REQUIRE(!sortedHas(sorted, 8));
+
+		bool found = true;
+		for (std::size_t size = 1; size < 70; size++)
+		{
+			std::vector<int> v(size);
+			std::iota(v.begin(), v.end(), 0);
+			for (std::size_t i = 0; i < size; i++)
+				found &= sortedIndexOf(v, static_cast<int>(i)) == i;
+		}
+		REQUIRE(found);
+
+		const std::vector<std::string> words = {"a", "b", "c"};
+		REQUIRE(sortedIndexOf(words, std::string("b")) == 1);
+	}
+
+	SECTION("removeAtUnordered, removeAtMany, removeIfUnordered")
+	{
+		std::vector<int> v = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+		removeAtUnordered(v, 2);
+		REQUIRE(v == std::vector<int>{0, 1, 9, 3, 4, 5, 6, 7, 8});
+		removeAtUnordered(v, 8);
+		REQUIRE(v == std::vector<int>{0, 1, 9, 3, 4, 5, 6, 7});
+
+		removeAtMany(v, std::vector<std::size_t>{0, 2, 2, 3, 7});
+		REQUIRE(v == std::vector<int>{1, 4, 5, 6});
+		removeAtMany(v, std::vector<std::size_t>{});
+		REQUIRE(v.size() == 4);
+		removeAtMany(v, std::set<std::size_t>{0, 1, 2, 3});
+		REQUIRE(v.empty());
+
+		/* Same survivors as removeIf, in any order. */
+
+		std::vector<int> all(1000);
+		std::iota(all.begin(), all.end(), 0);
+		for (const int modulo : {1, 2, 3, 7, 1001})
+		{
+			std::vector<int> ordered = all, unordered = all;
+			removeIf(ordered, [modulo](int n) { return n % modulo == 0; });
+			removeIfUnordered(unordered, [modulo](int n) { return n % modulo == 0; });
+			std::sort(unordered.begin(), unordered.end());
+			REQUIRE(unordered == ordered);
+		}
+
+		SmallVector<std::string, 4> strings = {"a", "b", "c", "d", "e"};
+		removeIfUnordered(strings, [](const std::string& s) { return s == "a" || s == "e"; });
+		REQUIRE(strings == SmallVector<std::string, 4>{"d", "b", "c"});
+		removeAtMany(strings, std::array<int, 1>{1});
+		REQUIRE(strings == SmallVector<std::string, 4>{"d", "c"});
+	}
+
+	SECTION("SmallVector")
+	{
+		SmallVector<std::string, 2> small = {"a", "b"};
+		REQUIRE(small.isInline());
+		small.push_back(small[0]); // Aliasing an element while growing
+		REQUIRE(!small.isInline());
+		REQUIRE(small.size() == 3);
+		REQUIRE(small.back() == "a");
+
+		SmallVector<std::string, 2> moved = std::move(small);
+		REQUIRE(small.empty());
+		REQUIRE(moved.size() == 3);
+		SmallVector<std::string, 2> copy = moved;
+		REQUIRE(copy == moved);
+
+		/* Existing algorithms work as with std::vector. */
+
+		SmallVector<int, 4> numbers = cast<int, SmallVector<int, 4>>(vec);
+		REQUIRE(numbers.isInline());
+		REQUIRE(indexOf(numbers, 2) == 1);
+		REQUIRE(atOr(numbers, 5, -1) == -1);
+		removeIf(numbers, [](int n) { return n == 2; });
+		REQUIRE(numbers == SmallVector<int, 4>{1, 3});
+		numbers.insert(numbers.begin(), 0);
+		removeAt(numbers, 1);
+		REQUIRE(numbers == SmallVector<int, 4>{0, 3});
+		numbers.resize(6, 7);
+		REQUIRE(!numbers.isInline());
+		REQUIRE(has(numbers, 7));
+	}
+
+	SECTION("StaticVector")
+	{
+		StaticVector<std::string, 2> fixed;
+		REQUIRE(fixed.tryPushBack("a") != nullptr);
+		fixed.emplace_back("b");
+		REQUIRE(fixed.full());
+		REQUIRE(fixed.tryPushBack("c") == nullptr);
+		REQUIRE_THROWS_AS(fixed.push_back("c"), std::bad_alloc);
+		REQUIRE(fixed.size() == 2);
+
+		StaticVector<std::string, 2> moved = std::move(fixed);
+		REQUIRE(moved[1] == "b");
+		remove(moved, std::string("a"));
+		REQUIRE(moved.size() == 1);
+
+		REQUIRE_THROWS_AS((cast<int, StaticVector<int, 2>>(vec)), std::bad_alloc);
+	}
+
+	SECTION("SlotMap")
+	{
+		SlotMap<std::string> map;
+		map.reserve(8);
+
+		const mcl::utils::Id a = map.insert("a");
+		const mcl::utils::Id b = map.insert("b");
+		const mcl::utils::Id c = map.insert("c");
+
+		REQUIRE(a.isValid());
+		REQUIRE(map.size() == 3);
+		REQUIRE(*map.get(b) == "b");
+
+		REQUIRE(map.erase(a));
+		REQUIRE(!map.erase(a));
+		REQUIRE(map.get(a) == nullptr);
+		REQUIRE(*map.get(c) == "c");
+		REQUIRE(map.size() == 2);
+
+		const mcl::utils::Id d = map.insert("d"); // Reuses a's slot
+		REQUIRE(d != a);
+		REQUIRE(!map.contains(a));
+		REQUIRE(*map.get(d) == "d");
+		REQUIRE(map.capacity() == 8);
+
+		std::set<std::string> values(map.begin(), map.end());
+		REQUIRE(values == std::set<std::string>{"b", "c", "d"});
+		for (std::size_t i = 0; i < map.size(); i++)
+			REQUIRE(*map.get(map.getKey(i)) == map.getData()[i]);
+
+		map.clear();
+		REQUIRE(map.empty());
+		REQUIRE(!map.contains(b));
+	}
+
+	SECTION("IdMap")
+	{
+		using mcl::utils::Id;
+
+		IdMap<std::string> map;
+		map.reserve(100);
+		const std::size_t capacity = map.capacity();
+		REQUIRE(capacity >= 100);
+
+		REQUIRE(map.emplace(Id{1}, "one").second);
+		REQUIRE(!map.emplace(Id{1}, "uno").second);
+		REQUIRE(*map.find(Id{1}) == "one");
+		map[Id{2}] = "two";
+		REQUIRE(map.size() == 2);
+		REQUIRE(map.erase(Id{1}));
+		REQUIRE(!map.erase(Id{1}));
+		REQUIRE(!map.contains(Id{1}));
+		REQUIRE(map.capacity() == capacity);
+
+		/* Randomized comparison against std::unordered_map, with many erasures
+		to exercise backward-shift deletion and rehashing. */
+
+		IdMap<int>                  ids;
+		std::unordered_map<Id, int> reference;
+		std::uint32_t               seed = 1;
+		for (int i = 0; i < 20000; i++)
+		{
+			seed         = seed * 1664525u + 1013904223u;
+			const Id key = Id{(seed >> 8) % 3000};
+			if (seed & 1)
+			{
+				ids[key]       = i;
+				reference[key] = i;
+			}
+			else
+				REQUIRE(ids.erase(key) == (reference.erase(key) == 1));
+		}
+		REQUIRE(ids.size() == reference.size());
+		for (const auto& [key, value] : reference)
+			REQUIRE(*ids.find(key) == value);
+
+		std::size_t count = 0;
+		ids.forEach([&count](Id, int) { count++; });
+		REQUIRE(count == reference.size());
+
+		IdMap<int> copy = ids;
+		REQUIRE(copy.size() == ids.size());
+	}
+
+	SECTION("RingBuffer")
+	{
+		RingBuffer<int> ring(5);
+		REQUIRE(ring.capacity() == 8);
+		REQUIRE(ring.empty());
+
+		int value = 0;
+		REQUIRE(!ring.pop(value));
+		for (int i = 0; i < 8; i++)
+			REQUIRE(ring.push(i));
+		REQUIRE(!ring.push(8));
+		REQUIRE(ring.size() == 8);
+		REQUIRE(ring.pop(value));
+		REQUIRE(value == 0);
+
+		/* Bulk operations, wrapping around the end of the storage. */
+
+		std::vector<int> out(16);
+		REQUIRE(ring.pop(std::span(out).first(5)) == 5);
+		REQUIRE(ring.push(std::vector<int>{10, 11, 12, 13, 14, 15, 16}) == 6);
+		REQUIRE(ring.pop(out) == 8);
+		REQUIRE(out[0] == 6);
+		REQUIRE(out[2] == 10);
+		REQUIRE(out[7] == 15);
+
+		/* Claims are contiguous: a wrapped region takes two rounds. */
+
+		REQUIRE(ring.claimWrite().size() == 2); // Tail at slot 6: 8 free slots, but only 2 before the end
+		ring.commitWrite(2);
+		std::span<int> region = ring.claimWrite(10);
+		REQUIRE(region.size() == 6);
+		std::iota(region.begin(), region.end(), 100);
+		ring.commitWrite(2);
+		REQUIRE(ring.size() == 4);
+		REQUIRE(ring.claimRead().size() == 2);
+		ring.commitRead(2);
+		REQUIRE(ring.claimRead().size() == 2);
+		REQUIRE(ring.claimRead()[1] == 101);
+		ring.commitRead(2);
+		REQUIRE(ring.empty());
+
+		/* One producer, one consumer. */
+
+		constexpr std::size_t   COUNT = 200000;
+		RingBuffer<std::size_t> queue(64);
+
+		const auto produce = [&queue]() {
+			std::size_t next = 0;
+			while (next < COUNT)
+			{
+				if (next % 3 == 0) // Mix single and bulk pushes
+				{
+					const std::size_t batch[] = {next, next + 1};
+					next += queue.push(std::span(batch, std::min<std::size_t>(2, COUNT - next)));
+				}
+				else if (queue.push(next))
+					next++;
+			}
+		};
+		std::thread producer(produce);
+
+		std::size_t expected = 0;
+		bool        ordered  = true;
+		while (expected < COUNT)
+		{
+			std::span<std::size_t> items = queue.claimRead(7);
+			for (const std::size_t item : items)
+				ordered &= item == expected++;
+			queue.commitRead(items.size());
+		}
+		producer.join();
+		REQUIRE(ordered);
+		REQUIRE(queue.empty());
+	}
+
+	SECTION("MpmcQueue")
+	{
+		MpmcQueue<int> queue(3);
+		REQUIRE(queue.capacity() == 4);
+
+		int value = 0;
+		REQUIRE(!queue.pop(value));
+		for (int i = 0; i < 4; i++)
+			REQUIRE(queue.push(i));
+		REQUIRE(!queue.push(4));
+		REQUIRE(queue.size() == 4);
+		REQUIRE(queue.pop(value));
+		REQUIRE(value == 0);
+		REQUIRE(queue.push(4));
+		for (int i = 1; i <= 4; i++)
+		{
+			REQUIRE(queue.pop(value));
+			REQUIRE(value == i);
+		}
+		REQUIRE(queue.size() == 0);
+
+		/* Many producers, many consumers: every item comes out exactly once. */
+
+		constexpr std::size_t    THREADS = 4;
+		constexpr std::size_t    COUNT   = 50000;
+		MpmcQueue<std::size_t>   shared(64);
+		std::vector<int>         seen(THREADS * COUNT);
+		std::atomic<std::size_t> consumed = 0;
+		std::vector<std::thread> threads;
+
+		for (std::size_t t = 0; t < THREADS; t++)
+		{
+			threads.emplace_back([&shared, t]() {
+				for (std::size_t i = 0; i < COUNT; i++)
+					while (!shared.push(t * COUNT + i))
+						std::this_thread::yield();
+			});
+			threads.emplace_back([&]() {
+				std::size_t item;
+				while (consumed.load() < THREADS * COUNT)
+				{
+					if (!shared.pop(item))
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					seen[item]++;
+					consumed++;
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		REQUIRE(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+	}
+}
+
+TEST_CASE("time")
+{
+	using namespace mcl::utils::time;
+	using namespace std::chrono_literals;
+
+	SECTION("sleepUntil, sleepFor")
+	{
+		for (const auto spin : {0us, 200us})
+		{
+			const Clock::time_point deadline = Clock::now() + 2ms;
+			sleepUntil(deadline, spin);
+			REQUIRE(Clock::now() >= deadline);
+
+			const Clock::time_point start = Clock::now();
+			sleepFor(1ms, spin);
+			REQUIRE(Clock::now() - start >= 1ms);
+		}
+
+		const Clock::time_point start = Clock::now();
+		sleepUntil(start - 1s); // Deadline in the past: no wait
+		REQUIRE(Clock::now() - start < 1s);
+	}
+
+	SECTION("PeriodicTimer")
+	{
+		// Only drift is checked: a slow or loaded machine may legitimately miss ticks
+		PeriodicTimer           timer(2ms);
+		const Clock::time_point start  = timer.getNextDeadline() - 2ms;
+		std::size_t             ticks  = 0;
+		std::size_t             missed = 0;
+		bool                    steady = true;
+		for (int i = 0; i < 10; i++)
+		{
+			missed += timer.wait();
+			ticks++;
+			std::this_thread::sleep_for(100us); // Work done in the loop: must not cause drift
+			steady &= timer.getNextDeadline() == start + (ticks + missed + 1) * 2ms;
+		}
+		REQUIRE(steady);
+		REQUIRE(Clock::now() >= start + (ticks + missed) * 2ms);
+
+		std::this_thread::sleep_for(9ms); // Next deadline is 2ms away at most: 3 ticks missed at least
+		const std::size_t late = timer.wait();
+		REQUIRE(late >= 3);
+		REQUIRE(timer.getNextDeadline() == start + (ticks + missed + late + 2) * 2ms);
+	}
+
+	SECTION("Stopwatch")
+	{
+		calibrate();
+		Stopwatch stopwatch;
+		std::this_thread::sleep_for(5ms);
+		const auto elapsed = stopwatch.getElapsed();
+		REQUIRE(elapsed >= 4ms); // Calibration error
+		REQUIRE(elapsed < 1s);
+
+		stopwatch.reset();
+		REQUIRE(stopwatch.getElapsed() < elapsed);
+	}
+
+	SECTION("LatencyHistogram")
+	{
+		LatencyHistogram histogram;
+		REQUIRE(histogram.getCount() == 0);
+		REQUIRE(histogram.getPercentile(50) == 0ns);
+
+		for (int i = 1; i <= 1000; i++)
+			histogram.record(std::chrono::microseconds(i));
+
+		const LatencyHistogram::Summary summary = histogram.getSummary();
+		REQUIRE(summary.count == 1000);
+		REQUIRE(summary.max == 1000us);
+		REQUIRE(summary.p50 >= 500us);
+		REQUIRE(summary.p50 <= 500us * 1.04);
+		REQUIRE(summary.p99 >= 990us);
+		REQUIRE(summary.p99 <= 990us * 1.04);
+		REQUIRE(summary.p999 <= summary.max);
+		REQUIRE(histogram.getPercentile(0) <= 1us * 1.04);
+
+		histogram.record(-1ns); // Clamped to zero
+		histogram.record(std::chrono::nanoseconds::max());
+		REQUIRE(histogram.getMax() == std::chrono::nanoseconds::max());
+
+		histogram.reset();
+		REQUIRE(histogram.getCount() == 0);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+			threads.emplace_back([&histogram]() {
+				for (int i = 0; i < 10000; i++)
+				{
+					ScopedTimer timer(histogram);
+				}
+			});
+		for (std::thread& t : threads)
+			t.join();
+		REQUIRE(histogram.getCount() == 40000);
+	}
+}
+
+TEST_CASE("os")
+{
+	using namespace mcl::utils::os;
+
+	SECTION("getCpuCount")
+	{
+		const CpuCount count = getCpuCount();
+		REQUIRE(count.logical >= 1);
+		REQUIRE(count.physical >= 1);
+		REQUIRE(count.physical <= count.logical);
+	}
+
+	/* Thread settings are tried on a separate thread, so that the test runner
+	is left untouched. Real-time scheduling and memory locking usually need
+	privileges: only check that failures are reported properly. */
+
+	SECTION("setRealtimePriority, lockMemory")
+	{
+		std::error_code priority, memory;
+		std::thread([&]() {
+			priority = setRealtimePriority(SchedPolicy::FIFO, 10);
+			memory   = lockMemory();
+			if (!memory)
+				unlockMemory();
+		}).join();
+		REQUIRE((!priority || priority == std::errc::operation_not_permitted || priority == std::errc::not_supported));
+		REQUIRE((!memory || memory == std::errc::operation_not_permitted || memory == std::errc::not_enough_memory || memory == std::errc::not_supported));
+	}
+
+	SECTION("setAffinity, prefaultStack, enableDenormalFlush")
+	{
+		std::error_code invalid, valid, denormals;
+		float           result = 1.0f;
+		std::thread([&]() {
+			const int cpus[] = {-1};
+			invalid          = setAffinity(cpus);
+#if defined(__linux__)
+			const int current[] = {sched_getcpu()};
+			valid               = setAffinity(current);
+#endif
+			prefaultStack();
+			denormals = enableDenormalFlush();
+
+			volatile float tiny = 1e-40f; // Denormal
+			result              = tiny * 2.0f;
+		}).join();
+		REQUIRE(invalid == std::errc::invalid_argument);
+		REQUIRE(!valid);
+		if (!denormals)
+			REQUIRE(result == 0.0f);
+	}
+}
+
+TEST_CASE("thread")
+{
+	using namespace mcl::utils::thread;
+
+	SECTION("submit")
+	{
+		ThreadPool pool(4);
+		REQUIRE(pool.getSize() == 4);
+
+		std::vector<Future<int>> futures;
+		for (int i = 0; i < 100; i++)
+			futures.push_back(pool.submit([i]() { return i * 2; }));
+		for (int i = 0; i < 100; i++)
+			REQUIRE(futures[i].get() == i * 2);
+
+		std::atomic<int> counter = 0;
+		Future<void>     done    = pool.submit([&counter]() { counter++; });
+		done.wait();
+		REQUIRE(done.isReady());
+		REQUIRE(counter == 1);
+
+		Future<std::string> failure = pool.submit([]() -> std::string { throw std::runtime_error("failure"); });
+		REQUIRE_THROWS_AS(failure.get(), std::runtime_error);
+	}
+
+	SECTION("Nested tasks are stolen by idle workers")
+	{
+		/* The parent keeps its worker busy until a child has run elsewhere, so
+		children can only make progress by being stolen from its deque. */
+
+		ThreadPool                pool(4);
+		std::atomic<int>          sum    = 0;
+		std::atomic<bool>         stolen = false;
+		std::vector<Future<void>> children;
+
+		Future<void> parent = pool.submit([&]() {
+			const std::thread::id parentId = std::this_thread::get_id();
+			for (int i = 1; i <= 1000; i++)
+				children.push_back(pool.submit([&, i]() {
+					sum += i;
+					if (std::this_thread::get_id() != parentId)
+						stolen = true;
+				}));
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while (!stolen && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::yield();
+		});
+		parent.wait();
+		REQUIRE(stolen);
+
+		for (Future<void>& child : children)
+			child.wait();
+		REQUIRE(sum == 500500);
+	}
+
+	SECTION("Priorities")
+	{
+		ThreadPool        pool(1);
+		std::atomic<bool> gate = false;
+		std::vector<int>  order;
+
+		Future<void> blocker = pool.submit([&gate]() {
+			while (!gate.load())
+				std::this_thread::yield();
+		});
+		std::vector<Future<void>> futures;
+		futures.push_back(pool.submit([&order]() { order.push_back(3); }, Priority::LOW));
+		futures.push_back(pool.submit([&order]() { order.push_back(2); }, Priority::NORMAL));
+		futures.push_back(pool.submit([&order]() { order.push_back(1); }, Priority::HIGH));
+		gate = true;
+		for (Future<void>& future : futures)
+			future.wait();
+		REQUIRE(order == std::vector<int>{1, 2, 3});
+	}
+
+	SECTION("Destructor runs pending tasks")
+	{
+		std::atomic<int> counter = 0;
+		{
+			ThreadPool pool(2, 8);
+			for (int i = 0; i < 1000; i++)
+				pool.submit([&counter]() { counter++; });
+		}
+		REQUIRE(counter == 1000);
+	}
+
+	SECTION("Default size")
+	{
+		ThreadPool pool;
+		REQUIRE(pool.getSize() == std::max(mcl::utils::os::getCpuCount().physical, 1u));
+	}
+}
+
+TEST_CASE("memory")
+{
+	using namespace mcl::utils::memory;
+
+	SECTION("ArenaResource")
+	{
+		ArenaResource arena(256);
+		REQUIRE(arena.getCapacity() == 256);
+
+		void* a = arena.allocate(10, 1);
+		void* b = arena.allocate(8, 8);
+		REQUIRE(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+		REQUIRE(static_cast<std::byte*>(b) >= static_cast<std::byte*>(a) + 10);
+		REQUIRE(arena.getUsed() == 24);
+		REQUIRE_THROWS_AS(arena.allocate(512), std::bad_alloc);
+
+		arena.reset();
+		REQUIRE(arena.getUsed() == 0);
+		REQUIRE(arena.getPeak() == 24);
+		REQUIRE(arena.allocate(10, 1) == a);
+
+		std::byte     buffer[64];
+		ArenaResource external(buffer);
+		REQUIRE(external.allocate(64, 1) == buffer);
+	}
+
+	SECTION("PoolResource")
+	{
+		PoolResource pool(20, 4);
+		REQUIRE(pool.getBlockSize() == 32);
+
+		std::set<void*> blocks;
+		for (int i = 0; i < 4; i++)
+			blocks.insert(pool.allocate(20));
+		REQUIRE(blocks.size() == 4);
+		REQUIRE_THROWS_AS(pool.allocate(20), std::bad_alloc);
+		REQUIRE_THROWS_AS(pool.allocate(64), std::bad_alloc);
+
+		void* first = *blocks.begin();
+		pool.deallocate(first, 20);
+		REQUIRE(pool.allocate(8) == first);
+
+		/* Requests the pool can't serve go upstream. */
+
+		PoolResource fallback(16, 1, std::pmr::new_delete_resource());
+		void*        big = fallback.allocate(1024);
+		fallback.deallocate(big, 1024);
+
+		/* Concurrent allocations never hand out the same block twice. */
+
+		constexpr std::size_t    THREADS = 4;
+		PoolResource             shared(16, THREADS * 8);
+		std::atomic<int>         collisions = 0;
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < THREADS; t++)
+		{
+			threads.emplace_back([&shared, &collisions, t]() {
+				for (int round = 0; round < 20000; round++)
+				{
+					std::array<unsigned char*, 8> mine;
+					for (unsigned char*& p : mine)
+					{
+						p = static_cast<unsigned char*>(shared.allocate(16));
+						std::fill_n(p, 16, static_cast<unsigned char>(t));
+					}
+					for (unsigned char* p : mine)
+					{
+						collisions += std::any_of(p, p + 16, [t](unsigned char c) { return c != t; });
+						shared.deallocate(p, 16);
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		REQUIRE(collisions == 0);
+	}
+
+	SECTION("pmr overloads")
+	{
+		ArenaResource arena(4096);
+
+		const std::set<int>         in     = {3, 1, 2};
+		const std::pmr::vector<int> casted = mcl::utils::container::cast<int>(in, &arena);
+		REQUIRE(casted == std::pmr::vector<int>{1, 2, 3});
+		REQUIRE(casted.get_allocator().resource() == &arena);
+
+		const std::size_t                        used   = arena.getUsed();
+		const std::pmr::vector<std::pmr::string> tokens = mcl::utils::string::split("a long enough token to skip SSO,b", ",", &arena);
+		REQUIRE(tokens.size() == 2);
+		REQUIRE(tokens[0] == "a long enough token to skip SSO");
+		REQUIRE(tokens[1] == "b");
+		REQUIRE(tokens[0].get_allocator().resource() == &arena);
+		REQUIRE(arena.getUsed() > used);
+	}
+}